@@ -0,0 +1,234 @@
+#ifndef EXCEPTIONHANDLING_ACCOUNT_POLICIES_H
+#define EXCEPTIONHANDLING_ACCOUNT_POLICIES_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
+// Policies for BasicAccount (bank_account.h). Each kind of rule is a template parameter,
+// so an account kind is a type and every rule is inlined into deposit()/withdraw():
+//
+//     using BankAccount    = BasicAccount<NoOverdraft, NoLimit, PositiveAmount>;               // the account from main()
+//     using PremiumAccount = BasicAccount<Overdraft<500.0>, DailyWithdrawalLimit<2000.0>, PositiveAmount>;
+//     using SavingsAccount = BasicAccount<MinimumBalance<100.0>, NoLimit, MinimumAmount<10.0>>;
+//     using CardAccount    = BasicAccount<NoOverdraft, NoLimit, PositiveAmount, VelocityLimit<10, 1000.0>>;
+//
+// OverdraftPolicy: how much of the balance can be withdrawn.
+//     static constexpr double available(double balance)   the largest amount withdraw() accepts
+// LimitPolicy: caps on withdrawals, may keep state (stored in the account, takes no space when empty).
+//     bool allows(double amount) const                    checked after the balance
+//     void record(double amount)                          called for every successful withdrawal
+//     double remaining() const                            reported in WithdrawalLimitException
+//     void startNewDay()                                  called by BasicAccount::startNewDay()
+// ValidationPolicy: which deposit and withdrawal amounts are valid.
+//     static constexpr bool valid(double amount)
+//     static constexpr bool kAcceptsEveryAmount           true if every positive Amount (amount.h) is valid,
+//                                                         the Amount overloads then skip the check
+// VelocityPolicy (optional, NoVelocityLimit by default): caps on withdrawals in a recent time window,
+// stored in the account like the LimitPolicy.
+//     bool allows(double amount) const                    checked after the LimitPolicy
+//     void record(double amount)                          called for every successful withdrawal
+//     unsigned withdrawals() const                        } the window so far,
+//     double withdrawn() const                            } reported in VelocityLimitException
+
+// --- OverdraftPolicy ---
+
+// The balance never goes below zero (BankAccount).
+struct NoOverdraft {
+    static constexpr double available(double balance) noexcept {
+        return balance;
+    }
+};
+
+// The balance can go down to -Limit.
+template <double Limit>
+struct Overdraft {
+    static_assert(Limit >= 0.0, "overdraft limit must not be negative");
+
+    static constexpr double available(double balance) noexcept {
+        return balance + Limit;
+    }
+};
+
+// The balance never goes below Minimum.
+template <double Minimum>
+struct MinimumBalance {
+    static_assert(Minimum >= 0.0, "minimum balance must not be negative");
+
+    static constexpr double available(double balance) noexcept {
+        return balance - Minimum;
+    }
+};
+
+// --- LimitPolicy ---
+
+// No cap on withdrawals (BankAccount).
+struct NoLimit {
+    constexpr bool allows(double) const noexcept { return true; }
+    constexpr void record(double) noexcept {}
+    constexpr double remaining() const noexcept { return 0.0; }
+    constexpr void startNewDay() noexcept {}
+};
+
+// At most Limit withdrawn per day. The account does not read a clock on every operation;
+// the end-of-day job calls startNewDay() on each account.
+template <double Limit>
+class DailyWithdrawalLimit {
+public:
+    static_assert(Limit > 0.0, "daily limit must be positive");
+
+    bool allows(double amount) const noexcept { return amount <= Limit - withdrawnToday_; }
+    void record(double amount) noexcept { withdrawnToday_ += amount; }
+    double remaining() const noexcept { return Limit - withdrawnToday_; }
+    void startNewDay() noexcept { withdrawnToday_ = 0.0; }
+
+private:
+    double withdrawnToday_ = 0.0;
+};
+
+// --- ValidationPolicy ---
+
+// Any amount above zero (BankAccount).
+struct PositiveAmount {
+    static constexpr bool kAcceptsEveryAmount = true;
+
+    static constexpr bool valid(double amount) noexcept {
+        return amount > 0.0;
+    }
+};
+
+// At least Minimum per operation.
+template <double Minimum>
+struct MinimumAmount {
+    static_assert(Minimum > 0.0, "minimum amount must be positive");
+    static constexpr bool kAcceptsEveryAmount = false;
+
+    static constexpr bool valid(double amount) noexcept {
+        return amount >= Minimum;
+    }
+};
+
+// --- VelocityPolicy ---
+
+// Time for the velocity limits, in ticks of the application's choosing (seconds in the examples).
+// A timer or the request loop moves it forward; the accounts only read it, which is one load from a cache line
+// that every core keeps, instead of a clock call per withdrawal.
+class VelocityClock {
+public:
+    static std::uint32_t now() noexcept { return tick_.load(std::memory_order_relaxed); }
+    static void set(std::uint32_t tick) noexcept { tick_.store(tick, std::memory_order_relaxed); }
+
+private:
+    static inline std::atomic<std::uint32_t> tick_{0};
+};
+
+// No velocity check (BankAccount).
+struct NoVelocityLimit {
+    constexpr bool allows(double) const noexcept { return true; }
+    constexpr void record(double) noexcept {}
+    constexpr unsigned withdrawals() const noexcept { return 0; }
+    constexpr double withdrawn() const noexcept { return 0.0; }
+};
+
+// At most MaxWithdrawals withdrawals and at most MaxAmount withdrawn per WindowTicks ticks of VelocityClock,
+// for example VelocityLimit<10, 1000.0> with a tick per second: 10 withdrawals or 1000 per minute.
+//
+// The window is a ring of Buckets counters, each covering WindowTicks / Buckets ticks: the bucket of the current
+// tick and the Buckets - 1 before it. So the window slides in steps of one bucket, and it covers between
+// WindowTicks - WindowTicks / Buckets and WindowTicks ticks of history. Buckets that have left the window are not
+// cleared by a timer: allows() skips them by their position relative to the newest bucket, and record() zeroes
+// them before it counts a withdrawal. After a pause of a whole window (most accounts, most of the time) both take
+// a short path that does not walk the ring.
+//
+// Everything is in the account, next to the balance: with the default 4 buckets the policy is 24 bytes
+// (4 float amounts, 4 byte counts, the newest bucket number) and the account 32, aligned to 32
+// (kAccountAlignment, bank_account.h), so an account never spans two cache lines and the check costs
+// no extra cache miss. The float amounts keep about 7 significant digits, plenty for a fraud limit.
+template <unsigned MaxWithdrawals, double MaxAmount, unsigned WindowTicks = 60, unsigned Buckets = 4>
+class VelocityLimit {
+public:
+    static_assert(MaxWithdrawals > 0 && MaxWithdrawals <= 255, "a bucket counts withdrawals in one byte");
+    static_assert(MaxAmount > 0.0, "velocity amount limit must be positive");
+    static_assert(Buckets > 0 && (Buckets & (Buckets - 1)) == 0, "the number of buckets must be a power of two");
+    static_assert(WindowTicks % Buckets == 0, "the window must be a whole number of buckets");
+
+    bool allows(double amount) const noexcept {
+        const std::uint32_t age = ageOf(currentBucket());
+        if (age >= Buckets) {
+            return amount <= MaxAmount;   // nothing left in the window
+        }
+        unsigned count = 0;
+        float sum = 0.0f;
+        for (unsigned slot = 0; slot < Buckets; ++slot) {
+            if (inWindow(slot, age)) {
+                count += counts_[slot];
+                sum += amounts_[slot];
+            }
+        }
+        return count < MaxWithdrawals && static_cast<double>(sum) + amount <= MaxAmount;
+    }
+
+    void record(double amount) noexcept {
+        const std::uint32_t bucket = currentBucket();
+        const std::uint32_t age = ageOf(bucket);
+        if (age >= Buckets) {
+            // Nothing left in the window: the common case for an account that is not used every minute.
+            std::fill(std::begin(counts_), std::end(counts_), std::uint8_t{0});
+            std::fill(std::begin(amounts_), std::end(amounts_), 0.0f);
+            newest_ = bucket;
+        } else if (age != 0) {
+            // Zero the slots of the buckets that have left the window.
+            for (std::uint32_t step = 1; step <= age; ++step) {
+                counts_[(newest_ + step) & (Buckets - 1)] = 0;
+                amounts_[(newest_ + step) & (Buckets - 1)] = 0.0f;
+            }
+            newest_ = bucket;
+        }
+        ++counts_[newest_ & (Buckets - 1)];
+        amounts_[newest_ & (Buckets - 1)] += static_cast<float>(amount);
+    }
+
+    unsigned withdrawals() const noexcept {
+        const std::uint32_t age = ageOf(currentBucket());
+        unsigned count = 0;
+        for (unsigned slot = 0; slot < Buckets; ++slot) {
+            if (inWindow(slot, age)) {
+                count += counts_[slot];
+            }
+        }
+        return count;
+    }
+
+    double withdrawn() const noexcept {
+        const std::uint32_t age = ageOf(currentBucket());
+        double sum = 0.0;
+        for (unsigned slot = 0; slot < Buckets; ++slot) {
+            if (inWindow(slot, age)) {
+                sum += amounts_[slot];
+            }
+        }
+        return sum;
+    }
+
+private:
+    static constexpr std::uint32_t kBucketTicks = WindowTicks / Buckets;
+
+    static std::uint32_t currentBucket() noexcept { return VelocityClock::now() / kBucketTicks; }
+
+    // Buckets since the newest slot was written. A clock that went back counts into the newest bucket.
+    std::uint32_t ageOf(std::uint32_t bucket) const noexcept {
+        return bucket > newest_ ? bucket - newest_ : 0;
+    }
+
+    // Whether a slot is still in the window: the newest slot is 0 buckets old when it was written,
+    // the one before it 1, and so on, and age buckets have passed since.
+    bool inWindow(unsigned slot, std::uint32_t age) const noexcept {
+        return ((newest_ - slot) & (Buckets - 1)) + age < Buckets;
+    }
+
+    float amounts_[Buckets] = {};
+    std::uint8_t counts_[Buckets] = {};
+    std::uint32_t newest_ = 0;   // bucket number of the newest slot
+};
+
+#endif //EXCEPTIONHANDLING_ACCOUNT_POLICIES_H
@@ -0,0 +1,141 @@
+#ifndef EXCEPTIONHANDLING_ACCOUNT_PROTOCOL_H
+#define EXCEPTIONHANDLING_ACCOUNT_PROTOCOL_H
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include "account_registry.h"
+#include "bank_account.h"
+
+// Binary protocol of the local account service (tools/account_server.cpp, tools/account_load_test.cpp).
+//
+// A client sends fixed-size Request records over a Unix domain stream socket and gets one fixed-size Reply per
+// request, in the same order. Requests can be pipelined: a client may send many before reading any reply,
+// and the server answers everything it has read with one write.
+// Both sides run on the same machine, so the records are sent in host byte order without any framing.
+//
+// Failures are never exceptions on the wire. The server calls the non-throwing try* functions of AccountRegistry
+// and sends the AccountStatus back; the only statuses the protocol adds are AccountExists and BadRequest.
+
+enum class Opcode : std::uint8_t {
+    Open = 1,       // register the account with amount as initial balance
+    Deposit = 2,
+    Withdraw = 3,
+    GetBalance = 4,
+};
+
+// AccountStatus values plus the ones only the protocol needs.
+enum class ReplyStatus : std::uint8_t {
+    Ok = static_cast<std::uint8_t>(AccountStatus::Ok),
+    InvalidAmount = static_cast<std::uint8_t>(AccountStatus::InvalidAmount),
+    InsufficientFunds = static_cast<std::uint8_t>(AccountStatus::InsufficientFunds),
+    CircuitOpen = static_cast<std::uint8_t>(AccountStatus::CircuitOpen),
+    UnknownAccount = static_cast<std::uint8_t>(AccountStatus::UnknownAccount),
+    LimitExceeded = static_cast<std::uint8_t>(AccountStatus::LimitExceeded),
+    VelocityExceeded = static_cast<std::uint8_t>(AccountStatus::VelocityExceeded),
+    AccountExists = 0x80,   // Open for an id that is already registered
+    BadRequest = 0x81,      // unknown opcode or reserved account id
+};
+
+struct Request {
+    std::uint64_t requestId;   // chosen by the client, copied into the reply
+    std::uint64_t account;
+    double amount;             // ignored by GetBalance
+    Opcode opcode;
+    std::uint8_t reserved[7];
+};
+
+struct Reply {
+    std::uint64_t requestId;
+    double balance;            // balance after the operation, 0 if it failed before finding the account
+    ReplyStatus status;
+    std::uint8_t reserved[7];
+};
+
+static_assert(sizeof(Request) == 32, "Request is part of the wire format");
+static_assert(sizeof(Reply) == 24, "Reply is part of the wire format");
+
+inline ReplyStatus toReplyStatus(AccountStatus status) noexcept {
+    return static_cast<ReplyStatus>(status);
+}
+
+inline Request makeRequest(Opcode opcode, std::uint64_t requestId, std::uint64_t account, double amount = 0.0) noexcept {
+    Request request{};
+    request.requestId = requestId;
+    request.account = account;
+    request.amount = amount;
+    request.opcode = opcode;
+    return request;
+}
+
+// Records are read from and written to byte buffers with memcpy, the buffers do not need any alignment.
+template <typename Record>
+inline Record loadRecord(const char* bytes) noexcept {
+    Record record;
+    std::memcpy(&record, bytes, sizeof record);
+    return record;
+}
+
+template <typename Record>
+inline void storeRecord(char* bytes, const Record& record) noexcept {
+    std::memcpy(bytes, &record, sizeof record);
+}
+
+// Execute one request against the registry. Never throws: every failure becomes the reply status.
+// (Open can still run out of memory when the table grows; the server treats that like any other allocation failure.)
+inline Reply handleRequest(AccountRegistry& registry, const Request& request) {
+    Reply reply{};
+    reply.requestId = request.requestId;
+    switch (request.opcode) {
+        case Opcode::Open:
+            if (request.account == AccountRegistry::kEmptyId) {
+                reply.status = ReplyStatus::BadRequest;
+                return reply;
+            }
+            if (!AccountRegistry::validOpeningBalance(request.amount)) {
+                reply.status = ReplyStatus::InvalidAmount;   // negative, NaN or infinite, straight from the wire
+                break;
+            }
+            reply.status = registry.open(request.account, request.amount) ? ReplyStatus::Ok
+                                                                          : ReplyStatus::AccountExists;
+            break;
+        case Opcode::Deposit:
+        case Opcode::Withdraw:
+            if (!std::isfinite(request.amount)) {
+                reply.status = ReplyStatus::InvalidAmount;   // NaN or infinite, straight from the wire
+                break;
+            }
+            reply.status = toReplyStatus(request.opcode == Opcode::Deposit
+                                             ? registry.tryDeposit(request.account, request.amount)
+                                             : registry.tryWithdraw(request.account, request.amount));
+            break;
+        case Opcode::GetBalance:
+            reply.status = registry.contains(request.account) ? ReplyStatus::Ok : ReplyStatus::UnknownAccount;
+            break;
+        default:
+            reply.status = ReplyStatus::BadRequest;
+            return reply;
+    }
+    if (const double* balance = registry.findBalance(request.account)) {
+        reply.balance = *balance;
+    }
+    return reply;
+}
+
+inline const char* replyStatusName(ReplyStatus status) noexcept {
+    switch (status) {
+        case ReplyStatus::Ok: return "Ok";
+        case ReplyStatus::InvalidAmount: return "InvalidAmount";
+        case ReplyStatus::InsufficientFunds: return "InsufficientFunds";
+        case ReplyStatus::CircuitOpen: return "CircuitOpen";
+        case ReplyStatus::UnknownAccount: return "UnknownAccount";
+        case ReplyStatus::LimitExceeded: return "LimitExceeded";
+        case ReplyStatus::VelocityExceeded: return "VelocityExceeded";
+        case ReplyStatus::AccountExists: return "AccountExists";
+        case ReplyStatus::BadRequest: return "BadRequest";
+    }
+    return "?";
+}
+
+#endif //EXCEPTIONHANDLING_ACCOUNT_PROTOCOL_H
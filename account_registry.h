@@ -0,0 +1,273 @@
+#ifndef EXCEPTIONHANDLING_ACCOUNT_REGISTRY_H
+#define EXCEPTIONHANDLING_ACCOUNT_REGISTRY_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "bank_account.h"
+#include "throw_helpers.h"
+
+// Registry of many accounts, keyed by their external 64-bit account id.
+// std::unordered_map<std::uint64_t, BankAccount> allocates one node per account and every lookup follows a pointer
+// from the bucket to that node. AccountRegistry is a flat open-addressing hash table instead:
+// id and balance are stored inline in one array of slots, so a lookup usually touches one cache line.
+//
+// Collisions use Robin Hood hashing: while probing for a free slot, an entry that is further away from its home slot
+// takes the place of one that is closer ("takes from the rich"). That keeps all probe sequences short,
+// and a lookup can stop as soon as it meets an entry that is closer to its home than the key would be.
+// Deleting shifts the following entries one slot back, so there are no tombstones.
+//
+// A slot is just id and balance (16 bytes, four per cache line). The distance of an entry from its home slot is
+// recomputed from the hash of its id when needed, and one id value, kEmptyId, marks an empty slot
+// (registering that id throws std::invalid_argument).
+//
+// Account rules are the same as BankAccount's. The throwing functions throw InvalidAmountException,
+// InsufficientFundsException and, for an id that is not registered, UnknownAccountException.
+// The try* functions return the same situations as AccountStatus.
+class AccountRegistry {
+public:
+    explicit AccountRegistry(std::size_t expectedAccounts = 0) {
+        std::size_t capacity = 16;
+        while (capacity * kMaxLoadNumerator < expectedAccounts * kMaxLoadDenominator) {
+            capacity *= 2;
+        }
+        slots_.resize(capacity);
+        mask_ = capacity - 1;
+    }
+
+    // The id value that marks an empty slot, it cannot be used as account id.
+    static constexpr std::uint64_t kEmptyId = ~std::uint64_t{0};
+
+    // A balance an account can be opened with: not negative, and a real number (not NaN or infinite),
+    // otherwise every later deposit and withdrawal would work on it.
+    static bool validOpeningBalance(double balance) noexcept {
+        return balance >= 0.0 && std::isfinite(balance);
+    }
+
+    // Register a new account. Returns false if the id is already registered.
+    // Throws InvalidAmountException for an opening balance that is not validOpeningBalance().
+    bool open(std::uint64_t id, double initialBalance = 0.0) {
+        if (id == kEmptyId) {
+            throw_invalid_argument("Account id is reserved");
+        }
+        if (!validOpeningBalance(initialBalance)) {
+            throw_invalid_amount("Invalid opening balance", initialBalance);
+        }
+        if (find(id) != nullptr) {
+            return false;
+        }
+        if ((size_ + 1) * kMaxLoadDenominator > slots_.size() * kMaxLoadNumerator) {
+            grow();
+        }
+        insertNew(id, initialBalance);
+        ++size_;
+        return true;
+    }
+
+    // Remove an account. Returns false if the id is not registered.
+    bool close(std::uint64_t id) noexcept {
+        std::size_t index = indexOf(id);
+        if (index == kNotFound) {
+            return false;
+        }
+        // Backward shift: move the following entries of the cluster one slot closer to their home.
+        for (;;) {
+            const std::size_t next = (index + 1) & mask_;
+            if (slots_[next].id == kEmptyId || distanceOf(slots_[next].id, next) == 0) {
+                slots_[index].id = kEmptyId;
+                break;
+            }
+            slots_[index] = slots_[next];
+            index = next;
+        }
+        --size_;
+        return true;
+    }
+
+    bool contains(std::uint64_t id) const noexcept {
+        return find(id) != nullptr;
+    }
+
+    // Amounts are checked as !(amount > 0.0), like PositiveAmount (account_policies.h): amount <= 0.0 would let
+    // NaN through, and a NaN balance would then allow every withdrawal.
+    void deposit(std::uint64_t id, double amount) {
+        double& balance = balanceOf(id);
+        if (!(amount > 0.0)) {
+            throw_invalid_amount("Invalid deposit amount", amount);
+        }
+        balance += amount;
+    }
+
+    void withdraw(std::uint64_t id, double amount) {
+        double& balance = balanceOf(id);
+        if (!(amount > 0.0)) {
+            throw_invalid_amount("Invalid withdrawal amount", amount);
+        }
+        if (amount > balance) {
+            throw_insufficient_funds(amount, balance);
+        }
+        balance -= amount;
+    }
+
+    double getBalance(std::uint64_t id) const {
+        const Slot* slot = find(id);
+        if (slot == nullptr) {
+            throw_unknown_account(id);
+        }
+        return slot->balance;
+    }
+
+    AccountStatus tryDeposit(std::uint64_t id, double amount) noexcept {
+        Slot* slot = find(id);
+        if (slot == nullptr) {
+            return AccountStatus::UnknownAccount;
+        }
+        if (!(amount > 0.0)) {
+            return AccountStatus::InvalidAmount;
+        }
+        slot->balance += amount;
+        return AccountStatus::Ok;
+    }
+
+    AccountStatus tryWithdraw(std::uint64_t id, double amount) noexcept {
+        Slot* slot = find(id);
+        if (slot == nullptr) {
+            return AccountStatus::UnknownAccount;
+        }
+        if (!(amount > 0.0)) {
+            return AccountStatus::InvalidAmount;
+        }
+        if (amount > slot->balance) {
+            return AccountStatus::InsufficientFunds;
+        }
+        slot->balance -= amount;
+        return AccountStatus::Ok;
+    }
+
+    // Balance of an account, or nullptr for an unknown id.
+    const double* findBalance(std::uint64_t id) const noexcept {
+        const Slot* slot = find(id);
+        return slot == nullptr ? nullptr : &slot->balance;
+    }
+
+    // Call f(id, balance) for every account, in no particular order.
+    template <typename F>
+    void forEach(F&& f) const {
+        for (const Slot& slot : slots_) {
+            if (slot.id != kEmptyId) {
+                f(slot.id, slot.balance);
+            }
+        }
+    }
+
+    // Start loading the home slot of an id that will be used soon, for loops over many ids
+    // (journal_replay.h): the cache misses of the next lookups overlap with the current one.
+    void prefetch(std::uint64_t id) const noexcept {
+        __builtin_prefetch(&slots_[hash(id) & mask_]);
+    }
+
+    std::size_t size() const noexcept { return size_; }
+    std::size_t capacity() const noexcept { return slots_.size(); }
+    std::size_t memoryBytes() const noexcept { return slots_.capacity() * sizeof(Slot); }
+
+private:
+    struct Slot {
+        std::uint64_t id = kEmptyId;
+        double balance = 0.0;
+    };
+
+    // Grow before the table is 7/8 full, Robin Hood probing stays short up to there.
+    static constexpr std::size_t kMaxLoadNumerator = 7;
+    static constexpr std::size_t kMaxLoadDenominator = 8;
+    static constexpr std::size_t kNotFound = ~std::size_t{0};
+
+    // Account ids can be sequential or clustered, mix all bits before using the low ones (splitmix64 finalizer).
+    static std::uint64_t hash(std::uint64_t id) noexcept {
+        id ^= id >> 30;
+        id *= 0xbf58476d1ce4e5b9ull;
+        id ^= id >> 27;
+        id *= 0x94d049bb133111ebull;
+        id ^= id >> 31;
+        return id;
+    }
+
+    // How far the entry with this id, stored at index, is from its home slot.
+    std::size_t distanceOf(std::uint64_t id, std::size_t index) const noexcept {
+        return (index - hash(id)) & mask_;
+    }
+
+    std::size_t indexOf(std::uint64_t id) const noexcept {
+        if (id == kEmptyId) {
+            return kNotFound;
+        }
+        std::size_t index = hash(id) & mask_;
+        for (std::size_t distance = 0;; ++distance) {
+            const Slot& slot = slots_[index];
+            if (slot.id == id) {
+                return index;
+            }
+            // An empty slot, or an entry closer to its home than we would be: the id is not in the table.
+            if (slot.id == kEmptyId || distanceOf(slot.id, index) < distance) {
+                return kNotFound;
+            }
+            index = (index + 1) & mask_;
+        }
+    }
+
+    Slot* find(std::uint64_t id) noexcept {
+        const std::size_t index = indexOf(id);
+        return index == kNotFound ? nullptr : &slots_[index];
+    }
+
+    const Slot* find(std::uint64_t id) const noexcept {
+        const std::size_t index = indexOf(id);
+        return index == kNotFound ? nullptr : &slots_[index];
+    }
+
+    double& balanceOf(std::uint64_t id) {
+        Slot* slot = find(id);
+        if (slot == nullptr) {
+            throw_unknown_account(id);
+        }
+        return slot->balance;
+    }
+
+    // Insert an id that is known not to be in the table.
+    void insertNew(std::uint64_t id, double balance) noexcept {
+        Slot entry{id, balance};
+        std::size_t index = hash(id) & mask_;
+        for (std::size_t distance = 0;; ++distance) {
+            Slot& slot = slots_[index];
+            if (slot.id == kEmptyId) {
+                slot = entry;
+                return;
+            }
+            const std::size_t slotDistance = distanceOf(slot.id, index);
+            if (slotDistance < distance) {
+                std::swap(slot, entry);
+                distance = slotDistance;
+            }
+            index = (index + 1) & mask_;
+        }
+    }
+
+    void grow() {
+        std::vector<Slot> old(slots_.size() * 2);
+        old.swap(slots_);
+        mask_ = slots_.size() - 1;
+        for (const Slot& slot : old) {
+            if (slot.id != kEmptyId) {
+                insertNew(slot.id, slot.balance);
+            }
+        }
+    }
+
+    std::vector<Slot> slots_;
+    std::size_t mask_ = 0;
+    std::size_t size_ = 0;
+};
+
+#endif //EXCEPTIONHANDLING_ACCOUNT_REGISTRY_H
@@ -0,0 +1,53 @@
+#ifndef EXCEPTIONHANDLING_AMOUNT_H
+#define EXCEPTIONHANDLING_AMOUNT_H
+
+#include "throw_helpers.h"
+
+// A money amount that is known to be positive.
+//
+// deposit(100.0) checks `amount <= 0.0` at runtime on every call, even though 100.0 can never fail the check.
+// An Amount can only be made in two ways, and both prove positivity once:
+//  - from a constant, 100.0_amount or Amount(100.0): the constructor is consteval, so the check runs in the compiler.
+//    A zero or negative constant does not compile.
+//  - from a runtime value, Amount::checked(value): checks once and throws InvalidAmountException
+//    like deposit()/withdraw() do.
+// The BankAccount overloads that take an Amount can then skip the amount check (withdraw() still checks the balance).
+
+// Not constexpr on purpose: calling it in a consteval function is a compile error, which is how
+// Amount(0.0) or -5.0_amount are rejected.
+inline void amount_must_be_positive() {}
+
+class Amount {
+public:
+    consteval Amount(double value) : value_(value) {
+        if (!(value > 0.0)) {
+            amount_must_be_positive();
+        }
+    }
+
+    static Amount checked(double value) {
+        if (!(value > 0.0)) {
+            throw_invalid_amount("Invalid amount", value);
+        }
+        return Amount(value, Unchecked{});
+    }
+
+    constexpr double value() const noexcept { return value_; }
+
+private:
+    struct Unchecked {};
+
+    constexpr Amount(double value, Unchecked) noexcept : value_(value) {}
+
+    double value_;
+};
+
+consteval Amount operator""_amount(long double value) {
+    return Amount(static_cast<double>(value));
+}
+
+consteval Amount operator""_amount(unsigned long long value) {
+    return Amount(static_cast<double>(value));
+}
+
+#endif //EXCEPTIONHANDLING_AMOUNT_H
@@ -0,0 +1,30 @@
+#ifndef EXCEPTIONHANDLING_AVERAGE_H
+#define EXCEPTIONHANDLING_AVERAGE_H
+
+#include "contracts.h"
+#include "error_codes.h"
+#include "throw_helpers.h"
+
+// Average of sum / total, with our own exceptions for the two invalid cases.
+// Both are preconditions (contracts.h): at check level off they are assumed instead of checked.
+inline double calculate_avg(int sum, int total) {
+    EH_EXPECTS(total != 0, throw_divide_by_zero());
+    EH_EXPECTS(sum >= 0 && total >= 0, throw_negative_value());
+    const double average = static_cast<double>(sum) / total;
+    EH_AUDIT(average >= 0.0 && average <= sum, "average of non-negative values is between 0 and sum");
+    return average;
+}
+
+// Non-throwing version: the same checks (always, at every check level), reported as an ArithmeticError.
+inline ArithmeticError try_calculate_avg(int sum, int total, double& average) noexcept {
+    if (total == 0) {
+        return ArithmeticError::DivideByZero;
+    }
+    if (sum < 0 || total < 0) {
+        return ArithmeticError::NegativeValue;
+    }
+    average = static_cast<double>(sum) / total;
+    return ArithmeticError::Ok;
+}
+
+#endif //EXCEPTIONHANDLING_AVERAGE_H
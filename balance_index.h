@@ -0,0 +1,265 @@
+#ifndef EXCEPTIONHANDLING_BALANCE_INDEX_H
+#define EXCEPTIONHANDLING_BALANCE_INDEX_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include "account_registry.h"
+
+// Ordered index over account balances, for risk queries such as "which accounts have less than X"
+// or "the K largest balances". Without an index both questions scan every account with getBalance().
+//
+// BalanceIndex keeps (balance, account id) pairs sorted in blocks of 64 to 128 entries.
+// A small directory holds the last (largest) entry of every block, so finding the right block is a binary search
+// over the directory and finding the position inside the block is a binary search over one contiguous array.
+// Inserting or erasing moves at most one block's worth of entries; a block that grows too big is split in two.
+// A range query costs O(log n) to find the start plus the entries it returns.
+
+class BalanceIndex {
+public:
+    struct Entry {
+        double balance;
+        std::uint64_t id;
+
+        bool operator<(const Entry& other) const noexcept {
+            return balance < other.balance || (balance == other.balance && id < other.id);
+        }
+        bool operator==(const Entry& other) const noexcept {
+            return balance == other.balance && id == other.id;
+        }
+    };
+
+    void insert(double balance, std::uint64_t id) {
+        const Entry entry{balance, id};
+        if (blocks_.empty()) {
+            blocks_.push_back({entry});
+            last_.push_back(entry);
+            ++size_;
+            return;
+        }
+        // Append to the last block when the entry is larger than everything, otherwise into the block it belongs to.
+        std::size_t b = blockFor(entry);
+        if (b == blocks_.size()) {
+            --b;
+        }
+        auto& block = blocks_[b];
+        block.insert(std::upper_bound(block.begin(), block.end(), entry), entry);
+        last_[b] = block.back();
+        ++size_;
+        if (block.size() >= 2 * kBlockSize) {
+            split(b);
+        }
+    }
+
+    // Remove an entry. Returns false if it is not in the index.
+    bool erase(double balance, std::uint64_t id) {
+        const Entry entry{balance, id};
+        const std::size_t b = blockFor(entry);
+        if (b == blocks_.size()) {
+            return false;
+        }
+        auto& block = blocks_[b];
+        const auto it = std::lower_bound(block.begin(), block.end(), entry);
+        if (it == block.end() || !(*it == entry)) {
+            return false;
+        }
+        block.erase(it);
+        --size_;
+        if (block.empty()) {
+            blocks_.erase(blocks_.begin() + static_cast<std::ptrdiff_t>(b));
+            last_.erase(last_.begin() + static_cast<std::ptrdiff_t>(b));
+        } else {
+            last_[b] = block.back();
+        }
+        return true;
+    }
+
+    void update(std::uint64_t id, double oldBalance, double newBalance) {
+        erase(oldBalance, id);
+        insert(newBalance, id);
+    }
+
+    // Call f(id, balance) for every account with low <= balance < high, in increasing balance order.
+    template <typename F>
+    void forEachInRange(double low, double high, F&& f) const {
+        for (std::size_t b = blockFor(Entry{low, 0}); b < blocks_.size(); ++b) {
+            const auto& block = blocks_[b];
+            auto it = std::lower_bound(block.begin(), block.end(), Entry{low, 0});
+            for (; it != block.end(); ++it) {
+                if (!(it->balance < high)) {
+                    return;
+                }
+                f(it->id, it->balance);
+            }
+        }
+    }
+
+    // Accounts with a balance below the limit, smallest first, at most maxResults of them.
+    std::vector<Entry> below(double limit, std::size_t maxResults = ~std::size_t{0}) const {
+        std::vector<Entry> result;
+        for (const auto& block : blocks_) {
+            for (const Entry& entry : block) {
+                if (!(entry.balance < limit) || result.size() == maxResults) {
+                    return result;
+                }
+                result.push_back(entry);
+            }
+        }
+        return result;
+    }
+
+    // The k largest balances, largest first.
+    std::vector<Entry> topK(std::size_t k) const {
+        std::vector<Entry> result;
+        result.reserve(std::min(k, size_));
+        for (auto block = blocks_.rbegin(); block != blocks_.rend(); ++block) {
+            for (auto it = block->rbegin(); it != block->rend(); ++it) {
+                if (result.size() == k) {
+                    return result;
+                }
+                result.push_back(*it);
+            }
+        }
+        return result;
+    }
+
+    std::size_t size() const noexcept { return size_; }
+
+private:
+    // Entries per block after a split. Big enough that the directory stays small,
+    // small enough that inserting in the middle of a block moves at most 2 KB.
+    static constexpr std::size_t kBlockSize = 64;
+
+    // (balance, id) as two unsigned integers with the same order as Entry::operator<.
+    // The bits of a double compare like an integer once the sign is handled: negative values get all bits flipped,
+    // positive ones only the sign bit. -0.0 is made 0.0 first, since the doubles compare equal.
+    struct OrderKey {
+        std::uint64_t bits;
+        std::uint64_t id;
+
+        // Integer compares combined with & and |, so there is no branch to mispredict.
+        bool operator<(const OrderKey& other) const noexcept {
+            return (bits < other.bits) | ((bits == other.bits) & (id < other.id));
+        }
+    };
+
+    static OrderKey orderKey(const Entry& entry) noexcept {
+        const double balance = entry.balance == 0.0 ? 0.0 : entry.balance;
+        std::uint64_t bits;
+        std::memcpy(&bits, &balance, sizeof bits);
+        bits ^= (bits >> 63) != 0 ? ~std::uint64_t{0} : std::uint64_t{1} << 63;
+        return {bits, entry.id};
+    }
+
+    // Position of the first entry in the directory that is not smaller than the key.
+    // Like std::lower_bound, but the comparison only selects the next base instead of branching:
+    // balances are random, so a branch would mispredict about every second step.
+    // This pays off for the directory, which is small and stays in cache. Inside the (cold) blocks std::lower_bound
+    // is faster, because the predicted branch lets the CPU start the next memory load before the current one arrives.
+    static std::size_t lowerBound(const std::vector<Entry>& entries, const Entry& key) noexcept {
+        std::size_t n = entries.size();
+        if (n == 0) {
+            return 0;
+        }
+        const OrderKey wanted = orderKey(key);
+        const Entry* base = entries.data();
+        while (n > 1) {
+            const std::size_t half = n / 2;
+            base += static_cast<std::size_t>(orderKey(base[half - 1]) < wanted) * half;
+            n -= half;
+        }
+        return static_cast<std::size_t>(base - entries.data()) + (orderKey(*base) < wanted ? 1 : 0);
+    }
+
+    // First block whose last entry is not smaller than the entry, blocks_.size() if there is none.
+    std::size_t blockFor(const Entry& entry) const {
+        return lowerBound(last_, entry);
+    }
+
+    void split(std::size_t b) {
+        auto& block = blocks_[b];
+        std::vector<Entry> upper(block.begin() + static_cast<std::ptrdiff_t>(kBlockSize), block.end());
+        block.resize(kBlockSize);
+        last_[b] = block.back();
+        const Entry upperLast = upper.back();
+        blocks_.insert(blocks_.begin() + static_cast<std::ptrdiff_t>(b + 1), std::move(upper));
+        last_.insert(last_.begin() + static_cast<std::ptrdiff_t>(b + 1), upperLast);
+    }
+
+    std::vector<std::vector<Entry>> blocks_;
+    std::vector<Entry> last_;
+    std::size_t size_ = 0;
+};
+
+// Accounts whose balances are kept in a BalanceIndex. Every successful deposit() or withdraw() updates the index,
+// failed ones change nothing (and throw, or return their AccountStatus, just like AccountRegistry).
+class IndexedAccounts {
+public:
+    bool open(std::uint64_t id, double initialBalance = 0.0) {
+        if (!registry_.open(id, initialBalance)) {
+            return false;
+        }
+        index_.insert(initialBalance, id);
+        return true;
+    }
+
+    bool close(std::uint64_t id) {
+        const double* balance = registry_.findBalance(id);
+        if (balance == nullptr) {
+            return false;
+        }
+        index_.erase(*balance, id);
+        return registry_.close(id);
+    }
+
+    void deposit(std::uint64_t id, double amount) {
+        const double before = registry_.getBalance(id);
+        registry_.deposit(id, amount);
+        index_.update(id, before, *registry_.findBalance(id));
+    }
+
+    void withdraw(std::uint64_t id, double amount) {
+        const double before = registry_.getBalance(id);
+        registry_.withdraw(id, amount);
+        index_.update(id, before, *registry_.findBalance(id));
+    }
+
+    AccountStatus tryDeposit(std::uint64_t id, double amount) {
+        return indexed(id, [&] { return registry_.tryDeposit(id, amount); });
+    }
+
+    AccountStatus tryWithdraw(std::uint64_t id, double amount) {
+        return indexed(id, [&] { return registry_.tryWithdraw(id, amount); });
+    }
+
+    double getBalance(std::uint64_t id) const {
+        return registry_.getBalance(id);
+    }
+
+    const AccountRegistry& accounts() const noexcept { return registry_; }
+    const BalanceIndex& index() const noexcept { return index_; }
+
+private:
+    template <typename Operation>
+    AccountStatus indexed(std::uint64_t id, Operation operation) {
+        const double* balance = registry_.findBalance(id);
+        if (balance == nullptr) {
+            return AccountStatus::UnknownAccount;
+        }
+        const double before = *balance;
+        const AccountStatus status = operation();
+        if (status == AccountStatus::Ok) {
+            index_.update(id, before, *registry_.findBalance(id));
+        }
+        return status;
+    }
+
+    AccountRegistry registry_;
+    BalanceIndex index_;
+};
+
+#endif //EXCEPTIONHANDLING_BALANCE_INDEX_H
@@ -0,0 +1,182 @@
+#ifndef EXCEPTIONHANDLING_BANK_ACCOUNT_H
+#define EXCEPTIONHANDLING_BANK_ACCOUNT_H
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <iostream>
+#include <stdexcept>
+#include <type_traits>
+
+#include "account_policies.h"
+#include "amount.h"
+#include "breadcrumbs.h"
+#include "contracts.h"
+#include "error_codes.h"
+#include "throw_helpers.h"
+
+// Bank account with exception handling, for any kind of account.
+// The rules that differ between account kinds (overdraft, withdrawal limits, valid amounts, velocity) are the
+// template parameters, see account_policies.h. They are resolved at compile time, so BankAccount below
+// compiles to the same code as a class with the rules written out.
+// Alignment of an account: its size (the balance and the policies that keep state) rounded up to a power of two,
+// at most a cache line. Then an account of up to 64 bytes never spans two cache lines, also in a std::vector
+// whose data starts in the middle of one: a VelocityLimit account is 32 bytes aligned to 32. BankAccount stays 8.
+template <typename LimitPolicy, typename VelocityPolicy>
+inline constexpr std::size_t kAccountAlignment = std::min<std::size_t>(
+    64, std::bit_ceil(sizeof(double) + (std::is_empty_v<LimitPolicy> ? 0 : sizeof(LimitPolicy)) +
+                      (std::is_empty_v<VelocityPolicy> ? 0 : sizeof(VelocityPolicy))));
+
+template <typename OverdraftPolicy, typename LimitPolicy, typename ValidationPolicy,
+          typename VelocityPolicy = NoVelocityLimit>
+class alignas(kAccountAlignment<LimitPolicy, VelocityPolicy>) BasicAccount {
+private:
+    double balance;
+    [[no_unique_address]] LimitPolicy limit;
+    [[no_unique_address]] VelocityPolicy velocity;
+
+    // Audit-level invariant (contracts.h), checked after every withdrawal: a withdrawal never takes the balance
+    // below what the account kind allows. Deposits only raise the balance and are not checked; an account kind
+    // with a minimum balance starts below it (at 0) until its first deposits.
+    void checkInvariant() const {
+        EH_AUDIT(OverdraftPolicy::available(balance) >= 0.0, "balance is never below what the account kind allows");
+    }
+
+    // The bodies of the double and the Amount overloads below. CheckAmount is false for an Amount when the account
+    // kind accepts every positive amount: the Amount was checked when it was made.
+    template <bool CheckAmount>
+    void depositChecked(double amount) {
+        leave_breadcrumb(BreadcrumbOp::Deposit, this, amount);
+        // Check if the deposit amount is valid (a precondition, see contracts.h)
+        if constexpr (CheckAmount) {
+            EH_EXPECTS(ValidationPolicy::valid(amount), throw_invalid_amount("Invalid deposit amount", amount));
+        }
+
+        // Perform the deposit operation
+        balance += amount;
+        std::cout << "Deposit successful. Current balance: " << balance << std::endl;
+    }
+
+    template <bool CheckAmount>
+    void withdrawChecked(double amount) {
+        leave_breadcrumb(BreadcrumbOp::Withdraw, this, amount);
+        // Check if the withdrawal amount is valid (a precondition, see contracts.h)
+        if constexpr (CheckAmount) {
+            EH_EXPECTS(ValidationPolicy::valid(amount), throw_invalid_amount("Invalid withdrawal amount", amount));
+        }
+
+        // Check if there are sufficient funds for the withdrawal
+        if (amount > OverdraftPolicy::available(balance)) {
+            throw_insufficient_funds(amount, balance);
+        }
+        if (!limit.allows(amount)) {
+            throw_withdrawal_limit(amount, limit.remaining());
+        }
+        if (!velocity.allows(amount)) {
+            throw_velocity_limit(amount, velocity.withdrawals(), velocity.withdrawn());
+        }
+
+        // Perform the withdrawal operation
+        balance -= amount;
+        limit.record(amount);
+        velocity.record(amount);
+        checkInvariant();
+        std::cout << "Withdrawal successful. Current balance: " << balance << std::endl;
+    }
+
+    template <bool CheckAmount>
+    AccountStatus tryDepositChecked(double amount) noexcept {
+        leave_breadcrumb(BreadcrumbOp::TryDeposit, this, amount);
+        if constexpr (CheckAmount) {
+            if (!ValidationPolicy::valid(amount)) {
+                return AccountStatus::InvalidAmount;
+            }
+        }
+        balance += amount;
+        return AccountStatus::Ok;
+    }
+
+    template <bool CheckAmount>
+    AccountStatus tryWithdrawChecked(double amount) noexcept {
+        leave_breadcrumb(BreadcrumbOp::TryWithdraw, this, amount);
+        if constexpr (CheckAmount) {
+            if (!ValidationPolicy::valid(amount)) {
+                return AccountStatus::InvalidAmount;
+            }
+        }
+        if (amount > OverdraftPolicy::available(balance)) {
+            return AccountStatus::InsufficientFunds;
+        }
+        if (!limit.allows(amount)) {
+            return AccountStatus::LimitExceeded;
+        }
+        if (!velocity.allows(amount)) {
+            return AccountStatus::VelocityExceeded;
+        }
+        balance -= amount;
+        limit.record(amount);
+        velocity.record(amount);
+        checkInvariant();
+        return AccountStatus::Ok;
+    }
+
+public:
+    BasicAccount() : balance(0.0) {
+        static_assert(sizeof(BasicAccount) > 64 || sizeof(BasicAccount) == alignof(BasicAccount),
+                      "an account of up to a cache line is aligned to its size");
+    }
+
+    // Deposit money into the account
+    void deposit(double amount) {
+        depositChecked<true>(amount);
+    }
+
+    // Withdraw money from the account
+    void withdraw(double amount) {
+        withdrawChecked<true>(amount);
+    }
+
+    // Non-throwing versions of deposit() and withdraw() for hot paths where failures are expected.
+    // They apply the same rules but return a status instead of throwing, and print nothing.
+    AccountStatus tryDeposit(double amount) noexcept {
+        return tryDepositChecked<true>(amount);
+    }
+
+    AccountStatus tryWithdraw(double amount) noexcept {
+        return tryWithdrawChecked<true>(amount);
+    }
+
+    // Overloads for an Amount (amount.h), which is positive by construction: the amount check is skipped
+    // when the account kind accepts every positive amount (ValidationPolicy::kAcceptsEveryAmount).
+    // deposit(100.0) still calls the double version; deposit(100.0_amount) calls these.
+    void deposit(Amount amount) {
+        depositChecked<!ValidationPolicy::kAcceptsEveryAmount>(amount.value());
+    }
+
+    void withdraw(Amount amount) {
+        withdrawChecked<!ValidationPolicy::kAcceptsEveryAmount>(amount.value());
+    }
+
+    AccountStatus tryDeposit(Amount amount) noexcept {
+        return tryDepositChecked<!ValidationPolicy::kAcceptsEveryAmount>(amount.value());
+    }
+
+    AccountStatus tryWithdraw(Amount amount) noexcept {
+        return tryWithdrawChecked<!ValidationPolicy::kAcceptsEveryAmount>(amount.value());
+    }
+
+    // Get the current account balance
+    double getBalance() const {
+        return balance;
+    }
+
+    // Reset the daily limits (LimitPolicy), called once per account by the end-of-day job.
+    void startNewDay() noexcept {
+        limit.startNewDay();
+    }
+};
+
+// The account main() uses: no overdraft, no withdrawal limit, any positive amount.
+using BankAccount = BasicAccount<NoOverdraft, NoLimit, PositiveAmount>;
+
+#endif //EXCEPTIONHANDLING_BANK_ACCOUNT_H
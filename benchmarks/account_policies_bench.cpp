@@ -0,0 +1,161 @@
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "bank_account.h"
+#include "bench_util.h"
+
+// Policy-based accounts (BasicAccount, account_policies.h) against the same rules behind virtual functions,
+// chosen at runtime per account. Two account kinds:
+//   standard  no overdraft, no limit, any positive amount (= BankAccount)
+//   premium   500 overdraft, 2000 per day, any positive amount
+// Every operation is a tryDeposit(2.0) + tryWithdraw(1.0) on one of 1024 accounts; every 1000 rounds is a new day.
+//
+// Usage: AccountPoliciesBench [operations, default 200000000]
+
+namespace {
+
+using PremiumAccount = BasicAccount<Overdraft<500.0>, DailyWithdrawalLimit<2000.0>, PositiveAmount>;
+
+// --- the same rules as interfaces ---
+
+struct OverdraftRule {
+    virtual ~OverdraftRule() = default;
+    virtual double available(double balance) const = 0;
+};
+
+struct LimitRule {
+    virtual ~LimitRule() = default;
+    virtual bool allows(double amount) const = 0;
+    virtual void record(double amount) = 0;
+    virtual void startNewDay() = 0;
+};
+
+struct ValidationRule {
+    virtual ~ValidationRule() = default;
+    virtual bool valid(double amount) const = 0;
+};
+
+struct NoOverdraftRule final : OverdraftRule {
+    double available(double balance) const override { return balance; }
+};
+
+struct OverdraftLimitRule final : OverdraftRule {
+    explicit OverdraftLimitRule(double limit) : limit(limit) {}
+    double available(double balance) const override { return balance + limit; }
+    double limit;
+};
+
+struct NoLimitRule final : LimitRule {
+    bool allows(double) const override { return true; }
+    void record(double) override {}
+    void startNewDay() override {}
+};
+
+struct DailyLimitRule final : LimitRule {
+    explicit DailyLimitRule(double limit) : limit(limit) {}
+    bool allows(double amount) const override { return amount <= limit - withdrawnToday; }
+    void record(double amount) override { withdrawnToday += amount; }
+    void startNewDay() override { withdrawnToday = 0.0; }
+    double limit;
+    double withdrawnToday = 0.0;
+};
+
+struct PositiveAmountRule final : ValidationRule {
+    bool valid(double amount) const override { return amount > 0.0; }
+};
+
+class VirtualAccount {
+public:
+    VirtualAccount(const OverdraftRule& overdraft, std::unique_ptr<LimitRule> limit, const ValidationRule& validation)
+        : overdraft_(&overdraft), limit_(std::move(limit)), validation_(&validation) {}
+
+    AccountStatus tryDeposit(double amount) noexcept {
+        if (!validation_->valid(amount)) {
+            return AccountStatus::InvalidAmount;
+        }
+        balance_ += amount;
+        return AccountStatus::Ok;
+    }
+
+    AccountStatus tryWithdraw(double amount) noexcept {
+        if (!validation_->valid(amount)) {
+            return AccountStatus::InvalidAmount;
+        }
+        if (amount > overdraft_->available(balance_)) {
+            return AccountStatus::InsufficientFunds;
+        }
+        if (!limit_->allows(amount)) {
+            return AccountStatus::LimitExceeded;
+        }
+        balance_ -= amount;
+        limit_->record(amount);
+        return AccountStatus::Ok;
+    }
+
+    void startNewDay() noexcept { limit_->startNewDay(); }
+
+private:
+    double balance_ = 0.0;
+    const OverdraftRule* overdraft_;
+    std::unique_ptr<LimitRule> limit_;
+    const ValidationRule* validation_;
+};
+
+const NoOverdraftRule noOverdraft;
+const OverdraftLimitRule overdraft500(500.0);
+const PositiveAmountRule positiveAmount;
+
+// Out of line, so the compiler does not see which rules an account gets.
+[[gnu::noinline]] VirtualAccount makeVirtualAccount(bool premium) {
+    if (premium) {
+        return VirtualAccount(overdraft500, std::make_unique<DailyLimitRule>(2000.0), positiveAmount);
+    }
+    return VirtualAccount(noOverdraft, std::make_unique<NoLimitRule>(), positiveAmount);
+}
+
+template <typename Account>
+void run(const char* name, std::uint64_t operations, std::vector<Account>& accounts) {
+    std::uint64_t ok = 0;
+    const std::uint64_t rounds = operations / 2 / accounts.size();
+    bench::Stopwatch watch;
+    for (std::uint64_t round = 0; round < rounds; ++round) {
+        for (Account& account : accounts) {
+            ok += account.tryDeposit(2.0) == AccountStatus::Ok;
+            ok += account.tryWithdraw(1.0) == AccountStatus::Ok;
+        }
+        if (round % 1000 == 999) {
+            for (Account& account : accounts) {
+                account.startNewDay();
+            }
+        }
+    }
+    bench::report(name, rounds * accounts.size() * 2, watch.seconds());
+    bench::doNotOptimize(ok);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const std::uint64_t operations = bench::argOr(argc, argv, 1, 200'000'000);
+    constexpr std::size_t kAccounts = 1024;
+
+    std::vector<BankAccount> standard(kAccounts);
+    std::vector<PremiumAccount> premium(kAccounts);
+    std::vector<VirtualAccount> virtualStandard;
+    std::vector<VirtualAccount> virtualPremium;
+    for (std::size_t i = 0; i < kAccounts; ++i) {
+        virtualStandard.push_back(makeVirtualAccount(false));
+        virtualPremium.push_back(makeVirtualAccount(true));
+    }
+    std::printf("sizeof BankAccount %zu, PremiumAccount %zu, VirtualAccount %zu\n",
+                sizeof(BankAccount), sizeof(PremiumAccount), sizeof(VirtualAccount));
+
+    for (int round = 0; round < 2; ++round) {
+        run("standard: policies (BankAccount)", operations, standard);
+        run("standard: virtual rules", operations, virtualStandard);
+        run("premium: policies", operations, premium);
+        run("premium: virtual rules", operations, virtualPremium);
+    }
+    return 0;
+}
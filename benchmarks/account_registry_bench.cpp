@@ -0,0 +1,112 @@
+#include <malloc.h>
+
+#include <algorithm>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "account_registry.h"
+#include "bank_account.h"
+#include "bench_util.h"
+
+// AccountRegistry against std::unordered_map<std::uint64_t, BankAccount> for sparse 64-bit account ids.
+// For every size: heap memory used by the container, random lookup latency (getBalance of existing ids),
+// and a deposit + withdraw mix through the non-throwing functions.
+//
+// Usage: AccountRegistryBench [largest number of accounts, default 10000000]
+// (100M accounts need about 6 GB for the unordered_map alone.)
+
+namespace {
+
+std::size_t heapInUse() {
+    // Small blocks (uordblks) plus the large blocks glibc takes directly with mmap (hblkhd).
+    const struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+}
+
+std::vector<std::uint64_t> sparseIds(std::size_t n) {
+    std::mt19937_64 rng(n);
+    std::vector<std::uint64_t> ids(n);
+    for (auto& id : ids) {
+        id = rng();
+    }
+    return ids;
+}
+
+std::vector<std::uint64_t> shuffled(std::vector<std::uint64_t> ids, std::size_t lookups) {
+    std::mt19937_64 rng(7);
+    std::vector<std::uint64_t> order(lookups);
+    for (auto& id : order) {
+        id = ids[rng() % ids.size()];
+    }
+    return order;
+}
+
+void runSize(std::size_t n) {
+    const std::vector<std::uint64_t> ids = sparseIds(n);
+    const std::vector<std::uint64_t> order = shuffled(ids, 5'000'000);
+    std::printf("--- %zu accounts\n", n);
+
+    {
+        const std::size_t before = heapInUse();
+        AccountRegistry registry(n);
+        for (std::uint64_t id : ids) {
+            registry.open(id, 100.0);
+        }
+        std::printf("%-44s %12.1f bytes/account\n", "AccountRegistry memory",
+                    static_cast<double>(heapInUse() - before) / static_cast<double>(n));
+
+        double sum = 0.0;
+        bench::Stopwatch lookups;
+        for (std::uint64_t id : order) {
+            sum += *registry.findBalance(id);
+        }
+        bench::report("AccountRegistry lookup", order.size(), lookups.seconds());
+
+        bench::Stopwatch updates;
+        for (std::uint64_t id : order) {
+            registry.tryDeposit(id, 1.0);
+            registry.tryWithdraw(id, 2.0);
+        }
+        bench::report("AccountRegistry deposit + withdraw", order.size() * 2, updates.seconds());
+        bench::doNotOptimize(sum);
+    }
+
+    {
+        const std::size_t before = heapInUse();
+        std::unordered_map<std::uint64_t, BankAccount> map;
+        map.reserve(n);
+        for (std::uint64_t id : ids) {
+            map[id].tryDeposit(100.0);
+        }
+        std::printf("%-44s %12.1f bytes/account\n", "unordered_map memory",
+                    static_cast<double>(heapInUse() - before) / static_cast<double>(n));
+
+        double sum = 0.0;
+        bench::Stopwatch lookups;
+        for (std::uint64_t id : order) {
+            sum += map.find(id)->second.getBalance();
+        }
+        bench::report("unordered_map lookup", order.size(), lookups.seconds());
+
+        bench::Stopwatch updates;
+        for (std::uint64_t id : order) {
+            auto it = map.find(id);
+            it->second.tryDeposit(1.0);
+            it = map.find(id);
+            it->second.tryWithdraw(2.0);
+        }
+        bench::report("unordered_map deposit + withdraw", order.size() * 2, updates.seconds());
+        bench::doNotOptimize(sum);
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const std::uint64_t largest = bench::argOr(argc, argv, 1, 10'000'000);
+    for (std::size_t n = 1'000'000; n <= largest; n *= 10) {
+        runSize(n);
+    }
+    return 0;
+}
@@ -0,0 +1,64 @@
+#include <cstdio>
+
+#include "amount.h"
+#include "bank_account.h"
+#include "bench_util.h"
+
+// BankAccount with double amounts against the Amount overloads (amount.h) that skip the amount check.
+// The wrappers are noinline, like a call into another translation unit: the compiler cannot see the value and
+// has to keep the check in the double version. (When deposit(100.0) is inlined at the call site, the compiler
+// folds the check away for a constant on its own; Amount also guarantees it when it cannot see the value.)
+// The amount is read from the command line and validated once with Amount::checked(), then used for every call.
+//
+// amount_codegen_report.sh shows the machine code of the wrappers from this binary.
+//
+// Usage: AmountBench [operations, default 200000000] [amount, default 1]
+
+namespace double_amount {
+
+[[gnu::noinline]] AccountStatus deposit(BankAccount& account, double amount) {
+    return account.tryDeposit(amount);
+}
+
+[[gnu::noinline]] AccountStatus withdraw(BankAccount& account, double amount) {
+    return account.tryWithdraw(amount);
+}
+
+} // namespace double_amount
+
+namespace typed_amount {
+
+[[gnu::noinline]] AccountStatus deposit(BankAccount& account, Amount amount) {
+    return account.tryDeposit(amount);
+}
+
+[[gnu::noinline]] AccountStatus withdraw(BankAccount& account, Amount amount) {
+    return account.tryWithdraw(amount);
+}
+
+} // namespace typed_amount
+
+template <typename Value, typename Deposit, typename Withdraw>
+void run(const char* name, std::uint64_t operations, Value amount, Deposit deposit, Withdraw withdraw) {
+    BankAccount account;
+    std::uint64_t ok = 0;
+    bench::Stopwatch watch;
+    for (std::uint64_t i = 0; i < operations / 2; ++i) {
+        ok += deposit(account, amount) == AccountStatus::Ok;
+        ok += withdraw(account, amount) == AccountStatus::Ok;
+    }
+    bench::report(name, operations, watch.seconds());
+    bench::doNotOptimize(ok);
+}
+
+int main(int argc, char** argv) {
+    const std::uint64_t operations = bench::argOr(argc, argv, 1, 200'000'000);
+    const double value = static_cast<double>(bench::argOr(argc, argv, 2, 1));
+    const Amount amount = Amount::checked(value);
+
+    for (int round = 0; round < 2; ++round) {
+        run("double: check on every call", operations, value, double_amount::deposit, double_amount::withdraw);
+        run("Amount: checked once", operations, amount, typed_amount::deposit, typed_amount::withdraw);
+    }
+    return 0;
+}
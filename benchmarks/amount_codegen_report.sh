@@ -0,0 +1,13 @@
+#!/bin/sh
+# Machine code of the deposit/withdraw wrappers in AmountBench: double amounts against Amount.
+# The double versions contain the compare against 0.0 and the branch to the InvalidAmount return,
+# the Amount versions only the balance update (and withdraw's balance check).
+# Usage: benchmarks/amount_codegen_report.sh <build directory>
+set -e
+binary="${1:-build}/benchmarks/AmountBench"
+
+for function in 'double_amount::deposit' 'typed_amount::deposit' 'double_amount::withdraw' 'typed_amount::withdraw'; do
+    echo "== $function"
+    objdump --disassemble --demangle --no-show-raw-insn "$binary" |
+        awk -v name="<$function(" '/^[0-9a-f]+ </ && index($0, name) { found = 1; next } found && /^$/ { exit } found { print }'
+done
@@ -0,0 +1,106 @@
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "account_registry.h"
+#include "balance_index.h"
+#include "bench_util.h"
+
+// Write path: deposit/withdraw on a plain AccountRegistry against IndexedAccounts (registry + BalanceIndex).
+// Read path: "accounts below X" and "top 100 balances", by scanning every account against the index.
+// Also checks that both answer the same.
+//
+// Usage: BalanceIndexBench [accounts]
+
+int main(int argc, char** argv) {
+    const std::size_t n = bench::argOr(argc, argv, 1, 1'000'000);
+    std::mt19937_64 rng(11);
+    std::uniform_real_distribution<double> balance(0.0, 10'000.0);
+
+    std::vector<std::uint64_t> ids(n);
+    AccountRegistry plain(n);
+    IndexedAccounts indexed;
+    for (auto& id : ids) {
+        id = rng();
+        const double initial = balance(rng);
+        plain.open(id, initial);
+        indexed.open(id, initial);
+    }
+
+    const std::size_t operations = 2'000'000;
+    std::vector<std::uint64_t> order(operations);
+    for (auto& id : order) {
+        id = ids[rng() % n];
+    }
+
+    {
+        bench::Stopwatch watch;
+        for (std::size_t i = 0; i < operations; ++i) {
+            if (i & 1) {
+                plain.tryWithdraw(order[i], 25.0);
+            } else {
+                plain.tryDeposit(order[i], 20.0);
+            }
+        }
+        bench::report("registry deposit/withdraw", operations, watch.seconds());
+    }
+    {
+        bench::Stopwatch watch;
+        for (std::size_t i = 0; i < operations; ++i) {
+            if (i & 1) {
+                indexed.tryWithdraw(order[i], 25.0);
+            } else {
+                indexed.tryDeposit(order[i], 20.0);
+            }
+        }
+        bench::report("indexed deposit/withdraw", operations, watch.seconds());
+    }
+
+    const double limit = 50.0;
+    const int queries = 100;
+    std::size_t scanned = 0;
+    {
+        bench::Stopwatch watch;
+        for (int q = 0; q < queries; ++q) {
+            scanned = 0;
+            indexed.accounts().forEach([&](std::uint64_t, double b) { scanned += b < limit; });
+        }
+        bench::report("below(50) by full scan", queries, watch.seconds());
+    }
+    std::size_t found = 0;
+    {
+        bench::Stopwatch watch;
+        for (int q = 0; q < queries; ++q) {
+            found = indexed.index().below(limit).size();
+        }
+        bench::report("below(50) by index", queries, watch.seconds());
+    }
+
+    std::vector<double> scanTop;
+    {
+        bench::Stopwatch watch;
+        for (int q = 0; q < queries; ++q) {
+            std::vector<double> all;
+            all.reserve(n);
+            indexed.accounts().forEach([&](std::uint64_t, double b) { all.push_back(b); });
+            std::partial_sort(all.begin(), all.begin() + 100, all.end(), std::greater<>());
+            scanTop.assign(all.begin(), all.begin() + 100);
+        }
+        bench::report("top 100 by full scan", queries, watch.seconds());
+    }
+    std::vector<BalanceIndex::Entry> indexTop;
+    {
+        bench::Stopwatch watch;
+        for (int q = 0; q < queries; ++q) {
+            indexTop = indexed.index().topK(100);
+        }
+        bench::report("top 100 by index", queries, watch.seconds());
+    }
+
+    bool same = scanned == found;
+    for (std::size_t i = 0; i < 100; ++i) {
+        same = same && scanTop[i] == indexTop[i].balance;
+    }
+    std::printf("%zu accounts below %.0f, answers %s\n", found, limit, same ? "match" : "DIFFER");
+    return same ? 0 : 1;
+}
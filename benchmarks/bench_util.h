@@ -0,0 +1,54 @@
+#ifndef EXCEPTIONHANDLING_BENCH_UTIL_H
+#define EXCEPTIONHANDLING_BENCH_UTIL_H
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+
+// Small helpers shared by the benchmark programs in this directory.
+// They are plain executables (no benchmark framework), every result is printed as one line.
+
+namespace bench {
+
+using Clock = std::chrono::steady_clock;
+
+class Stopwatch {
+public:
+    Stopwatch() : start_(Clock::now()) {}
+
+    double seconds() const {
+        return std::chrono::duration<double>(Clock::now() - start_).count();
+    }
+
+private:
+    Clock::time_point start_;
+};
+
+// Keep the compiler from optimizing away a value we computed only for the benchmark.
+template <typename T>
+inline void doNotOptimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+inline void report(const char* name, std::uint64_t operations, double seconds) {
+    std::printf("%-44s %12.2f Mops/s %10.2f ns/op\n", name,
+                static_cast<double>(operations) / seconds / 1e6,
+                seconds * 1e9 / static_cast<double>(operations));
+}
+
+// Read the n-th command line argument as a number, or use the default value.
+inline std::uint64_t argOr(int argc, char** argv, int index, std::uint64_t fallback) {
+    return index < argc ? std::strtoull(argv[index], nullptr, 10) : fallback;
+}
+
+// BankAccount prints a line for every successful operation.
+// The benchmarks switch std::cout off so we measure the account and not the terminal.
+inline void silenceCout() {
+    std::cout.setstate(std::ios::failbit);
+}
+
+} // namespace bench
+
+#endif //EXCEPTIONHANDLING_BENCH_UTIL_H
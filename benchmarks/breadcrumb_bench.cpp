@@ -0,0 +1,86 @@
+// Overhead of the breadcrumbs (breadcrumbs.h).
+// This file is built twice, BreadcrumbBench with breadcrumbs and BreadcrumbOffBench without, so the BankAccount lines
+// of the two programs compare the same loop with and without them. EH_BENCH_BREADCRUMBS replaces the breadcrumb
+// setting of the build for this program; it is a single file, so the whole program sees the same value.
+// A failed withdraw() also measures the snapshot the throw helpers take before throwing.
+//
+// Usage: BreadcrumbBench [operations, default 50000000]
+//
+// The last run writes its breadcrumbs to breadcrumbs.bin; look at them with ./tools/BreadcrumbDecode breadcrumbs.bin
+
+#ifdef EH_BENCH_BREADCRUMBS
+#undef EH_BREADCRUMBS
+#define EH_BREADCRUMBS EH_BENCH_BREADCRUMBS
+#endif
+
+#include <cstdio>
+#include <vector>
+
+#include "bank_account.h"
+#include "bench_util.h"
+#include "breadcrumbs.h"
+
+int main(int argc, char** argv) {
+    const std::uint64_t operations = bench::argOr(argc, argv, 1, 50'000'000);
+    std::printf("breadcrumbs %s\n", EH_BREADCRUMBS ? "on" : "off");
+
+    {
+        bench::Stopwatch watch;
+        for (std::uint64_t i = 0; i < operations; ++i) {
+            leave_breadcrumb(BreadcrumbOp::TryDeposit, &watch, static_cast<double>(i));
+        }
+        bench::report("leave_breadcrumb", operations, watch.seconds());
+    }
+
+    {
+        std::vector<BankAccount> accounts(1024);
+        bench::Stopwatch watch;
+        for (std::uint64_t i = 0; i < operations / 2; ++i) {
+            BankAccount& account = accounts[i & 1023];
+            account.tryDeposit(1.0);
+            account.tryWithdraw(2.0);
+        }
+        bench::report("BankAccount tryDeposit + tryWithdraw", operations, watch.seconds());
+        bench::doNotOptimize(accounts.front());
+    }
+
+    {
+        BreadcrumbSnapshot snapshot;
+        const std::uint64_t snapshots = operations / 100;
+        bench::Stopwatch watch;
+        for (std::uint64_t i = 0; i < snapshots; ++i) {
+            snapshot_breadcrumbs(snapshot);
+            bench::doNotOptimize(snapshot);
+        }
+        bench::report("snapshot of a full ring", snapshots, watch.seconds());
+    }
+
+    {
+        bench::silenceCout();
+        BankAccount account;
+        const std::uint64_t throws = operations / 200;
+        std::uint64_t caught = 0;
+        bench::Stopwatch watch;
+        for (std::uint64_t i = 0; i < throws; ++i) {
+            try {
+                account.withdraw(1.0);
+            } catch (const InsufficientFundsException&) {
+                ++caught;
+            }
+        }
+        bench::report("failed withdraw (throw + catch)", throws, watch.seconds());
+        bench::doNotOptimize(caught);
+    }
+
+    if (EH_BREADCRUMBS) {
+        BankAccount account;
+        account.tryDeposit(50.0);
+        account.tryWithdraw(20.0);
+        try {
+            account.withdraw(100.0);
+        } catch (const InsufficientFundsException&) {
+            write_breadcrumbs("breadcrumbs.bin", last_breadcrumb_snapshot());
+        }
+    }
+    return 0;
+}
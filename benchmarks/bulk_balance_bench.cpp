@@ -0,0 +1,103 @@
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "bank_account.h"
+#include "bench_util.h"
+#include "bulk_balance.h"
+
+// Month-end interest and fee over all balances, in accounts per second:
+//  - per-object loop: one BankAccount per customer, deposit(interest) and withdraw(fee), catching "Insufficient funds"
+//  - per-object try*: the same with tryDeposit()/tryWithdraw(), no exceptions
+//  - applyInterestAndFee() with the scalar, AVX2 and AVX-512 kernels
+// Also checks that all kernels produce exactly the same balances and failed accounts.
+//
+// Usage: BulkBalanceBench [accounts]
+
+namespace {
+
+constexpr double kRate = 0.001;
+constexpr double kFee = 5.0;
+
+std::vector<double> initialBalances(std::size_t n) {
+    std::mt19937_64 rng(3);
+    std::uniform_real_distribution<double> balance(0.5, 200.0);
+    std::vector<double> balances(n);
+    for (double& b : balances) {
+        b = balance(rng);
+    }
+    return balances;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const std::size_t n = bench::argOr(argc, argv, 1, 10'000'000);
+    const std::vector<double> initial = initialBalances(n);
+    bench::silenceCout();
+
+    {
+        std::vector<BankAccount> accounts(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            accounts[i].tryDeposit(initial[i]);
+        }
+        std::size_t failed = 0;
+        bench::Stopwatch watch;
+        for (BankAccount& account : accounts) {
+            account.deposit(account.getBalance() * kRate);
+            try {
+                account.withdraw(kFee);
+            } catch (const std::runtime_error&) {
+                ++failed;
+            }
+        }
+        bench::report("per-object deposit/withdraw (throws)", n, watch.seconds());
+        bench::doNotOptimize(failed);
+    }
+
+    {
+        std::vector<BankAccount> accounts(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            accounts[i].tryDeposit(initial[i]);
+        }
+        std::size_t failed = 0;
+        bench::Stopwatch watch;
+        for (BankAccount& account : accounts) {
+            account.tryDeposit(account.getBalance() * kRate);
+            failed += account.tryWithdraw(kFee) != AccountStatus::Ok;
+        }
+        bench::report("per-object tryDeposit/tryWithdraw", n, watch.seconds());
+        bench::doNotOptimize(failed);
+    }
+
+    std::vector<double> reference;
+    std::vector<std::size_t> referenceFailed;
+    const std::pair<BulkKernel, const char*> kernels[] = {
+        {BulkKernel::Scalar, "applyInterestAndFee scalar"},
+        {BulkKernel::Avx2, "applyInterestAndFee AVX2"},
+        {BulkKernel::Avx512, "applyInterestAndFee AVX-512"},
+    };
+    for (const auto& [kernel, name] : kernels) {
+        if (kernel != BulkKernel::Scalar && static_cast<int>(kernel) > static_cast<int>(bestBulkKernel())) {
+            std::printf("%-44s not supported by this CPU\n", name);
+            continue;
+        }
+        std::vector<double> balances = initial;
+        std::vector<std::size_t> failed;
+        failed.reserve(n / 16);
+        bench::Stopwatch watch;
+        applyInterestAndFee(balances.data(), balances.size(), kRate, kFee, failed, kernel);
+        bench::report(name, n, watch.seconds());
+
+        if (reference.empty()) {
+            reference = balances;
+            referenceFailed = failed;
+            std::printf("%zu of %zu accounts could not pay the fee\n", failed.size(), n);
+        } else if (failed != referenceFailed ||
+                   std::memcmp(balances.data(), reference.data(), n * sizeof(double)) != 0) {
+            std::printf("%s differs from the scalar result!\n", name);
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,121 @@
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench_util.h"
+#include "checkpoint.h"
+
+// Incremental checkpoints (checkpoint.h): time and size of a checkpoint against the fraction of accounts that
+// changed since the last one, next to a full snapshot of every balance.
+//   random      the changed accounts are spread over all accounts
+//   clustered   they come in runs of 256 consecutive accounts (say, the customers of one branch)
+// Before each row the store writes a full base (compact()), so every row is a delta against a fresh base unless
+// checkpoint() decides that a base is cheaper. Files are flushed with fdatasync, as in production; on tmpfs or a
+// page cache that ignores the flush the times are memory copies only.
+//
+// It also compares the write path (tryDeposit()) with a plain balance array without dirty bits, and checks that
+// restore() after a chain of deltas gives back every balance.
+//
+// Usage: CheckpointBench [directory for the checkpoint files, default .] [accounts, default 10000000]
+
+namespace {
+
+void touch(CheckpointedBalances& balances, std::vector<double>& expected, std::size_t account, double amount) {
+    balances.tryDeposit(account, amount);
+    expected[account] += amount;
+}
+
+// Change about fraction * size accounts.
+void modify(CheckpointedBalances& balances, std::vector<double>& expected, double fraction, bool clustered,
+            std::mt19937_64& rng) {
+    const std::size_t accounts = balances.size();
+    const auto changes = static_cast<std::size_t>(fraction * static_cast<double>(accounts));
+    if (clustered) {
+        constexpr std::size_t kRun = 256;
+        for (std::size_t done = 0; done < changes; done += kRun) {
+            const std::size_t start = rng() % (accounts - kRun);
+            for (std::size_t i = 0; i < kRun && done + i < changes; ++i) {
+                touch(balances, expected, start + i, 1.0);
+            }
+        }
+    } else {
+        for (std::size_t i = 0; i < changes; ++i) {
+            touch(balances, expected, rng() % accounts, 1.0);
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const std::string directory = (argc > 1 ? std::string(argv[1]) : std::string(".")) + "/checkpoint_bench";
+    const std::size_t accounts = bench::argOr(argc, argv, 2, 10'000'000);
+    std::filesystem::remove_all(directory);
+
+    {
+        std::vector<double> plain(accounts, 100.0);
+        CheckpointedBalances balances(directory, accounts, 100.0);
+        std::mt19937_64 rng(5);
+        std::vector<std::uint32_t> targets(10'000'000);
+        for (std::uint32_t& target : targets) {
+            target = static_cast<std::uint32_t>(rng() % accounts);
+        }
+        bench::Stopwatch plainWatch;
+        for (std::uint32_t target : targets) {
+            plain[target] += 1.0;
+        }
+        bench::report("write path: plain balance array", targets.size(), plainWatch.seconds());
+        bench::doNotOptimize(plain.data());
+        bench::Stopwatch trackedWatch;
+        std::size_t ok = 0;
+        for (std::uint32_t target : targets) {
+            ok += balances.tryDeposit(target, 1.0) == AccountStatus::Ok;
+        }
+        bench::report("write path: tryDeposit() with dirty bits", targets.size(), trackedWatch.seconds());
+        bench::doNotOptimize(ok);
+    }
+    std::filesystem::remove_all(directory);
+
+    CheckpointedBalances balances(directory, accounts, 100.0);
+    std::vector<double> expected(accounts, 100.0);
+    std::mt19937_64 rng(7);
+    std::printf("%-10s %10s %12s %6s %10s %10s\n", "pattern", "changed", "dirty blocks", "kind", "MB", "ms");
+    for (const bool clustered : {false, true}) {
+        for (const double fraction : {0.0001, 0.001, 0.01, 0.1, 1.0}) {
+            bench::Stopwatch fullWatch;
+            const CheckpointResult base = balances.compact();
+            const double fullSeconds = fullWatch.seconds();
+            if (!clustered && fraction == 0.0001) {
+                std::printf("%-10s %10s %12s %6s %10.1f %10.1f\n", "-", "full", "all", "base",
+                            static_cast<double>(base.bytes) / 1e6, fullSeconds * 1e3);
+            }
+            modify(balances, expected, fraction, clustered, rng);
+            const double dirty = static_cast<double>(balances.dirtyBlocks()) / static_cast<double>(balances.blocks());
+            bench::Stopwatch watch;
+            const CheckpointResult result = balances.checkpoint();
+            const double seconds = watch.seconds();
+            std::printf("%-10s %9.2f%% %11.2f%% %6s %10.2f %10.2f\n", clustered ? "clustered" : "random",
+                        fraction * 100.0, dirty * 100.0, result.full ? "base" : "delta",
+                        static_cast<double>(result.bytes) / 1e6, seconds * 1e3);
+        }
+    }
+
+    // A chain of small deltas after the last base, then restore.
+    for (int i = 0; i < 20; ++i) {
+        modify(balances, expected, 0.001, i % 2 == 0, rng);
+        balances.checkpoint();
+    }
+    bench::Stopwatch restoreWatch;
+    const CheckpointedBalances restored = CheckpointedBalances::restore(directory);
+    const double restoreSeconds = restoreWatch.seconds();
+    std::size_t wrong = 0;
+    for (std::size_t account = 0; account < accounts; ++account) {
+        wrong += restored.getBalance(account) != expected[account];
+    }
+    std::printf("restore: base + %zu deltas in %.1f ms, %zu balances differ\n", restored.deltasSinceBase(),
+                restoreSeconds * 1e3, wrong);
+    std::filesystem::remove_all(directory);
+    return wrong == 0 ? 0 : 1;
+}
@@ -0,0 +1,71 @@
+#include <ctime>
+
+#include "bank_account.h"
+#include "bench_util.h"
+#include "circuit_breaker.h"
+
+// Sustained failures: every withdrawal from an empty account fails with InsufficientFundsException.
+//  - "no breaker":   BankAccount::withdraw(), every call throws and is caught
+//  - "breaker":      BreakerAccount, opens after the first 20 calls and rejects the rest with CircuitOpen
+//  - "breaker (healthy)": the overhead of the breaker when every call succeeds
+// Prints wall time and process CPU time per call.
+//
+// Usage: CircuitBreakerBench [calls]
+
+namespace {
+
+template <typename Call>
+void measure(const char* name, std::uint64_t calls, Call call) {
+    const std::clock_t cpuStart = std::clock();
+    bench::Stopwatch watch;
+    for (std::uint64_t i = 0; i < calls; ++i) {
+        call();
+    }
+    const double seconds = watch.seconds();
+    const double cpu = static_cast<double>(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+    bench::report(name, calls, seconds);
+    std::printf("%-44s %12.2f ns CPU/op\n", "", cpu * 1e9 / static_cast<double>(calls));
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const std::uint64_t calls = bench::argOr(argc, argv, 1, 1'000'000);
+    bench::silenceCout();
+
+    BankAccount empty;
+    std::uint64_t failures = 0;
+    measure("no breaker (every call throws)", calls, [&] {
+        try {
+            empty.withdraw(10.0);
+        } catch (const std::runtime_error&) {
+            ++failures;
+        }
+    });
+
+    CircuitBreakerConfig config;
+    config.openDuration = std::chrono::milliseconds(60'000);
+    BreakerAccount guarded(empty, config);
+    std::uint64_t rejected = 0;
+    measure("breaker (open after 20 failures)", calls, [&] {
+        try {
+            rejected += guarded.withdraw(10.0) == AccountStatus::CircuitOpen;
+        } catch (const std::runtime_error&) {
+            ++failures;
+        }
+    });
+    std::printf("rejected without throwing: %llu of %llu\n",
+                static_cast<unsigned long long>(rejected), static_cast<unsigned long long>(calls));
+
+    BankAccount healthy;
+    CircuitBreaker shared;
+    BreakerAccount globalScope(healthy, shared);
+    measure("breaker (healthy, deposits succeed)", calls * 10, [&] {
+        bench::doNotOptimize(globalScope.deposit(1.0));
+    });
+    measure("plain deposit (healthy)", calls * 10, [&] {
+        healthy.deposit(1.0);
+    });
+    bench::doNotOptimize(failures);
+    return 0;
+}
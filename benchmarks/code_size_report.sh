@@ -0,0 +1,13 @@
+#!/bin/sh
+# Per-function code size of the hot functions in ThrowHelpersBench, inline throws against cold throw helpers.
+# Usage: benchmarks/code_size_report.sh <build directory>
+set -e
+binary="${1:-build}/benchmarks/ThrowHelpersBench"
+
+# Hot part of a function: its own symbol. GCC moves the cold blocks of the helper version into
+# a separate "<name>.cold" symbol in .text.unlikely, those are listed separately.
+nm --size-sort --print-size --demangle "$binary" |
+    grep -E " (inline_throw|cold_helpers)::|throw_(divide_by_zero|negative_value|invalid_amount|insufficient_funds)" |
+    while read -r address size type name; do
+        printf '%6d bytes  %s\n' "$((0x$size))" "$name"
+    done
@@ -0,0 +1,89 @@
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "bank_account.h"
+#include "bench_util.h"
+#include "failure_fast_path.h"
+
+// Failed withdrawals per second against the number of threads.
+// Every worker owns an empty BankAccount and keeps withdrawing from it, so every call fails.
+//  - "throw":     BankAccount::withdraw() throws std::runtime_error, the worker catches it
+//  - "fast path": FailureFastPath in FastPath mode, one failure in 1024 still throws
+//
+// Usage: ConcurrentThrowBench [max threads] [operations per thread]
+
+namespace {
+
+template <typename Worker>
+double run(unsigned threads, std::uint64_t perThread, Worker worker) {
+    std::atomic<unsigned> ready{0};
+    std::atomic<bool> go{false};
+    std::vector<std::thread> pool;
+    for (unsigned t = 0; t < threads; ++t) {
+        pool.emplace_back([&] {
+            ready.fetch_add(1);
+            while (!go.load()) {
+                std::this_thread::yield();
+            }
+            worker(perThread);
+        });
+    }
+    while (ready.load() != threads) {
+        std::this_thread::yield();
+    }
+    bench::Stopwatch watch;
+    go.store(true);
+    for (auto& thread : pool) {
+        thread.join();
+    }
+    return watch.seconds();
+}
+
+void throwingWorker(std::uint64_t operations) {
+    BankAccount account;
+    std::uint64_t caught = 0;
+    for (std::uint64_t i = 0; i < operations; ++i) {
+        try {
+            account.withdraw(10.0);
+        } catch (const std::runtime_error&) {
+            ++caught;
+        }
+    }
+    bench::doNotOptimize(caught);
+}
+
+void fastPathWorker(std::uint64_t operations) {
+    const FailureFastPath fastPath(FailureMode::FastPath, 1024);
+    BankAccount account;
+    std::uint64_t caught = 0;
+    for (std::uint64_t i = 0; i < operations; ++i) {
+        try {
+            bench::doNotOptimize(fastPath.withdraw(account, 10.0));
+        } catch (const std::runtime_error&) {
+            ++caught;
+        }
+    }
+    bench::doNotOptimize(caught);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const auto hardware = std::max(1u, std::thread::hardware_concurrency());
+    const auto maxThreads = static_cast<unsigned>(bench::argOr(argc, argv, 1, hardware * 2));
+    const std::uint64_t perThread = bench::argOr(argc, argv, 2, 200'000);
+
+    std::printf("%8s %20s %20s\n", "threads", "throw (failures/s)", "fast path (failures/s)");
+    for (unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+        const std::uint64_t total = perThread * threads;
+        const double throwing = run(threads, perThread, throwingWorker);
+        // The fast path is much cheaper per failure, give it more work so the timing is not just thread start-up.
+        const double fast = run(threads, perThread * 50, fastPathWorker);
+        std::printf("%8u %20.0f %20.0f\n", threads,
+                    static_cast<double>(total) / throwing,
+                    static_cast<double>(total * 50) / fast);
+    }
+    return 0;
+}
@@ -0,0 +1,70 @@
+// Cost of the contract checks (contracts.h) at each check level.
+// This file is built three times, ContractsOffBench, ContractsFastBench and ContractsAuditBench;
+// EH_BENCH_CHECK_LEVEL replaces the check level of the build for this program.
+//
+// Usage: ContractsFastBench [operations, default 100000000]
+
+#ifdef EH_BENCH_CHECK_LEVEL
+#undef EH_CHECK_LEVEL
+#define EH_CHECK_LEVEL EH_BENCH_CHECK_LEVEL
+#endif
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "average.h"
+#include "bank_account.h"
+#include "bench_util.h"
+
+int main(int argc, char** argv) {
+    const std::uint64_t operations = bench::argOr(argc, argv, 1, 100'000'000);
+    const char* levels[] = {"off", "fast", "audit"};
+    std::printf("check level %s\n", levels[EH_CHECK_LEVEL]);
+
+    {
+        // Valid input only: the checks never fail, we measure what they cost on the way.
+        std::mt19937 rng(1);
+        std::vector<int> sums(4096);
+        std::vector<int> totals(4096);
+        for (std::size_t i = 0; i < sums.size(); ++i) {
+            sums[i] = static_cast<int>(rng() % 100000);
+            totals[i] = static_cast<int>(rng() % 1000) + 1;
+        }
+        double result = 0.0;
+        bench::Stopwatch watch;
+        for (std::uint64_t done = 0; done < operations; done += sums.size()) {
+            for (std::size_t i = 0; i < sums.size(); ++i) {
+                result += calculate_avg(sums[i], totals[i]);
+            }
+        }
+        bench::report("calculate_avg", operations, watch.seconds());
+        bench::doNotOptimize(result);
+    }
+
+    {
+        std::vector<BankAccount> accounts(1024);
+        bench::Stopwatch watch;
+        for (std::uint64_t i = 0; i < operations / 2; ++i) {
+            BankAccount& account = accounts[i & 1023];
+            account.tryDeposit(2.0);
+            account.tryWithdraw(1.0);
+        }
+        bench::report("BankAccount tryDeposit + tryWithdraw", operations, watch.seconds());
+        bench::doNotOptimize(accounts.front());
+    }
+
+    {
+        bench::silenceCout();
+        BankAccount account;
+        const std::uint64_t calls = operations / 10;
+        bench::Stopwatch watch;
+        for (std::uint64_t i = 0; i < calls / 2; ++i) {
+            account.deposit(2.0);
+            account.withdraw(1.0);
+        }
+        bench::report("BankAccount deposit + withdraw", calls, watch.seconds());
+        bench::doNotOptimize(account);
+    }
+    return 0;
+}
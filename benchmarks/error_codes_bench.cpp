@@ -0,0 +1,156 @@
+#include <cstdio>
+#include <cstring>
+#include <system_error>
+#include <vector>
+
+#include "bank_account.h"
+#include "bench_util.h"
+#include "error_codes.h"
+#include "exceptions.h"
+
+// Telling errors apart by error code (error_codes.h) instead of by the text of what().
+//
+//   inspect: classify exception objects that exist already, by strcmp on what() or by comparing code()
+//   propagate: a failing withdrawal three calls down, reported to the top as
+//     an exception that the top classifies by what(),
+//     an exception that the top classifies by code(),
+//     a std::error_code returned through every level (tryWithdraw, no exception).
+//
+// Usage: ErrorCodesBench [throws, default 1000000]
+
+namespace {
+
+// The strings a caller would have to know to tell the account errors apart without codes.
+int classifyByMessage(const std::exception& e) {
+    const char* message = e.what();
+    if (std::strcmp(message, "Insufficient funds") == 0) {
+        return 1;
+    }
+    if (std::strcmp(message, "Invalid deposit amount") == 0 || std::strcmp(message, "Invalid withdrawal amount") == 0) {
+        return 2;
+    }
+    if (std::strcmp(message, "Unknown account") == 0) {
+        return 3;
+    }
+    return 0;
+}
+
+int classifyByCode(const CodedError& e) {
+    const std::error_code code = e.code();
+    if (code == AccountStatus::InsufficientFunds) {
+        return 1;
+    }
+    if (code == AccountStatus::InvalidAmount) {
+        return 2;
+    }
+    if (code == AccountStatus::UnknownAccount) {
+        return 3;
+    }
+    return 0;
+}
+
+[[gnu::noinline]] void withdrawLevel3(BankAccount& account) {
+    account.withdraw(10.0);
+}
+
+[[gnu::noinline]] void withdrawLevel2(BankAccount& account) {
+    withdrawLevel3(account);
+}
+
+[[gnu::noinline]] void withdrawLevel1(BankAccount& account) {
+    withdrawLevel2(account);
+}
+
+[[gnu::noinline]] std::error_code tryWithdrawLevel3(BankAccount& account) {
+    return account.tryWithdraw(10.0);
+}
+
+[[gnu::noinline]] std::error_code tryWithdrawLevel2(BankAccount& account) {
+    if (const std::error_code error = tryWithdrawLevel3(account)) {
+        return error;
+    }
+    return {};
+}
+
+[[gnu::noinline]] std::error_code tryWithdrawLevel1(BankAccount& account) {
+    if (const std::error_code error = tryWithdrawLevel2(account)) {
+        return error;
+    }
+    return {};
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const std::uint64_t throws = bench::argOr(argc, argv, 1, 1'000'000);
+    const std::uint64_t inspections = throws * 100;
+
+    // Inspection only. The last entry is the case with the longest string comparisons: an unknown account.
+    const InsufficientFundsException insufficient(10.0, 5.0);
+    const InvalidAmountException invalid("Invalid withdrawal amount", -1.0);
+    const UnknownAccountException unknown(7);
+    const std::vector<const std::exception*> exceptions = {&insufficient, &invalid, &unknown};
+    const std::vector<const CodedError*> coded = {&insufficient, &invalid, &unknown};
+
+    {
+        int sum = 0;
+        bench::Stopwatch watch;
+        for (std::uint64_t i = 0; i < inspections; ++i) {
+            sum += classifyByMessage(*exceptions[i % 3]);
+        }
+        bench::report("inspect: strcmp what()", inspections, watch.seconds());
+        bench::doNotOptimize(sum);
+    }
+
+    {
+        int sum = 0;
+        bench::Stopwatch watch;
+        for (std::uint64_t i = 0; i < inspections; ++i) {
+            sum += classifyByCode(*coded[i % 3]);
+        }
+        bench::report("inspect: compare code()", inspections, watch.seconds());
+        bench::doNotOptimize(sum);
+    }
+
+    BankAccount empty;
+
+    {
+        int sum = 0;
+        bench::Stopwatch watch;
+        for (std::uint64_t i = 0; i < throws; ++i) {
+            try {
+                withdrawLevel1(empty);
+            } catch (const std::exception& e) {
+                sum += classifyByMessage(e);
+            }
+        }
+        bench::report("propagate: throw, classify by what()", throws, watch.seconds());
+        bench::doNotOptimize(sum);
+    }
+
+    {
+        int sum = 0;
+        bench::Stopwatch watch;
+        for (std::uint64_t i = 0; i < throws; ++i) {
+            try {
+                withdrawLevel1(empty);
+            } catch (const CodedError& e) {
+                sum += classifyByCode(e);
+            }
+        }
+        bench::report("propagate: throw, classify by code()", throws, watch.seconds());
+        bench::doNotOptimize(sum);
+    }
+
+    {
+        int sum = 0;
+        bench::Stopwatch watch;
+        for (std::uint64_t i = 0; i < inspections; ++i) {
+            const std::error_code error = tryWithdrawLevel1(empty);
+            sum += error == AccountStatus::InsufficientFunds;
+        }
+        bench::report("propagate: return std::error_code", inspections, watch.seconds());
+        bench::doNotOptimize(sum);
+    }
+    return 0;
+}
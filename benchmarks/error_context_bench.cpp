@@ -0,0 +1,98 @@
+#include <exception>
+#include <stdexcept>
+
+#include "bench_util.h"
+#include "error_context.h"
+#include "throw_helpers.h"
+
+// Cost of adding context to an exception on its way through `depth` levels of calls.
+//   plain      the exception passes every level untouched (baseline)
+//   context    with_error_context() at every level: catch, add a frame to the inline chain, rethrow the same object
+//   nested     std::throw_with_nested() at every level: wrap the exception in a new std::runtime_error
+// The "per frame" column is (time - plain time) / depth.
+//
+// Usage: ErrorContextBench [throws per depth, default 100000]
+
+namespace {
+
+// noipa and an explicit return after the call: GCC 12 reports -Winfinite-recursion for a recursion whose only
+// way out is a [[noreturn]] call (also one it infers), although the throw ends it.
+__attribute__((noipa)) void fail() {
+    throw_invalid_argument("bottom");
+}
+
+__attribute__((noinline)) void plain(int depth) {
+    if (depth == 0) {
+        fail();
+        return;
+    }
+    plain(depth - 1);
+    bench::doNotOptimize(depth);
+}
+
+__attribute__((noinline)) void withContext(int depth) {
+    if (depth == 0) {
+        fail();
+        return;
+    }
+    with_error_context("while doing the next level", [depth] { withContext(depth - 1); });
+}
+
+__attribute__((noinline)) void nested(int depth) {
+    if (depth == 0) {
+        fail();
+        return;
+    }
+    try {
+        nested(depth - 1);
+    } catch (...) {
+        std::throw_with_nested(std::runtime_error("while doing the next level"));
+    }
+}
+
+// Time one throw through all levels, including reading the context back in the handler.
+template <typename Levels, typename Read>
+double run(std::uint64_t throws, int depth, Levels levels, Read read) {
+    std::size_t frames = 0;
+    bench::Stopwatch watch;
+    for (std::uint64_t i = 0; i < throws; ++i) {
+        try {
+            levels(depth);
+        } catch (const std::exception& e) {
+            frames += read(e);
+        }
+    }
+    const double seconds = watch.seconds();
+    bench::doNotOptimize(frames);
+    return seconds * 1e9 / static_cast<double>(throws);
+}
+
+std::size_t countNested(const std::exception& e) {
+    try {
+        std::rethrow_if_nested(e);
+    } catch (const std::exception& inner) {
+        return 1 + countNested(inner);
+    }
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const std::uint64_t throws = bench::argOr(argc, argv, 1, 100'000);
+    std::printf("%-8s %14s %14s %14s %16s %16s\n", "depth", "plain ns", "context ns", "nested ns",
+                "context/frame", "nested/frame");
+    for (int depth : {1, 2, 4, 8, 16}) {
+        const double base = run(throws, depth, plain, [](const std::exception&) { return std::size_t{0}; });
+        const double context = run(throws, depth, withContext,
+                                   [](const std::exception&) {
+                                       const std::size_t frames = current_error_context().size();
+                                       clear_error_context();
+                                       return frames;
+                                   });
+        const double wrapped = run(throws, depth, nested, countNested);
+        std::printf("%-8d %14.0f %14.0f %14.0f %16.0f %16.0f\n", depth, base, context, wrapped,
+                    (context - base) / depth, (wrapped - base) / depth);
+    }
+    return 0;
+}
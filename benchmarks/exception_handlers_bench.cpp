@@ -0,0 +1,166 @@
+#include <cstdio>
+#include <exception>
+#include <new>
+#include <stdexcept>
+#include <vector>
+
+#include "bench_util.h"
+#include "exception_handlers.h"
+#include "exceptions.h"
+
+// ExceptionHandlerRegistry (exception_handlers.h) against the catch ladder it replaces.
+// Both handle the same 10 exception types plus "anything else"; the exceptions thrown end up at different
+// depths of the ladder (first clause, third, sixth, ..., the catch (...) at the end).
+//
+//   ladder              throw + a 10-deep catch ladder
+//   registry            throw + catch (const std::exception&) + dispatch(e)
+//   registry (ptr)      throw + catch (...) + dispatch(std::current_exception()), which rethrows once more
+//   dispatch only       dispatch(e) on exception objects that exist already: the cached lookup alone
+//
+// Usage: ExceptionHandlersBench [throws, default 1000000]
+
+namespace {
+
+std::uint64_t handled[11];
+
+[[gnu::noinline]] void throwKind(int kind) {
+    switch (kind) {
+        case 0: throw MyException();
+        case 1: throw NegativeValueException();
+        case 2: throw UnknownAccountException(7);
+        case 3: throw std::invalid_argument("bad argument");
+        case 4: throw InsufficientFundsException(10.0, 5.0);
+        case 5: throw std::runtime_error("runtime error");
+        case 6: throw std::bad_alloc();
+        default: throw 42;
+    }
+}
+
+constexpr int kKinds = 8;
+
+void handleWithLadder(int kind) {
+    try {
+        throwKind(kind);
+    } catch (const MyException&) {
+        ++handled[0];
+    } catch (const DivideByZeroException&) {
+        ++handled[1];
+    } catch (const NegativeValueException&) {
+        ++handled[2];
+    } catch (const InvalidAmountException&) {
+        ++handled[3];
+    } catch (const InsufficientFundsException&) {
+        ++handled[4];
+    } catch (const UnknownAccountException&) {
+        ++handled[5];
+    } catch (const std::invalid_argument&) {
+        ++handled[6];
+    } catch (const std::out_of_range&) {
+        ++handled[7];
+    } catch (const std::runtime_error&) {
+        ++handled[8];
+    } catch (const std::exception&) {
+        ++handled[9];
+    } catch (...) {
+        ++handled[10];
+    }
+}
+
+void registerHandlers(ExceptionHandlerRegistry& handlers) {
+    handlers.on<MyException>([](const MyException&) { ++handled[0]; });
+    handlers.on<DivideByZeroException>([](const DivideByZeroException&) { ++handled[1]; });
+    handlers.on<NegativeValueException>([](const NegativeValueException&) { ++handled[2]; });
+    handlers.on<InvalidAmountException>([](const InvalidAmountException&) { ++handled[3]; });
+    handlers.on<InsufficientFundsException>([](const InsufficientFundsException&) { ++handled[4]; });
+    handlers.on<UnknownAccountException>([](const UnknownAccountException&) { ++handled[5]; });
+    handlers.on<std::invalid_argument>([](const std::invalid_argument&) { ++handled[6]; });
+    handlers.on<std::out_of_range>([](const std::out_of_range&) { ++handled[7]; });
+    handlers.on<std::runtime_error>([](const std::runtime_error&) { ++handled[8]; });
+    handlers.on<std::exception>([](const std::exception&) { ++handled[9]; });
+    handlers.onUnknown([] { ++handled[10]; });
+}
+
+void resetCounts() {
+    for (auto& count : handled) {
+        count = 0;
+    }
+}
+
+void printCounts() {
+    std::printf("  handled per clause:");
+    for (auto count : handled) {
+        std::printf(" %llu", static_cast<unsigned long long>(count));
+    }
+    std::printf("\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const std::uint64_t throws = bench::argOr(argc, argv, 1, 1'000'000);
+    ExceptionHandlerRegistry handlers;
+    registerHandlers(handlers);
+
+    {
+        resetCounts();
+        bench::Stopwatch watch;
+        for (std::uint64_t i = 0; i < throws; ++i) {
+            handleWithLadder(static_cast<int>(i % kKinds));
+        }
+        bench::report("ladder", throws, watch.seconds());
+        printCounts();
+    }
+
+    {
+        resetCounts();
+        bench::Stopwatch watch;
+        for (std::uint64_t i = 0; i < throws; ++i) {
+            try {
+                throwKind(static_cast<int>(i % kKinds));
+            } catch (const std::exception& e) {
+                handlers.dispatch(e);
+            } catch (...) {
+                handlers.dispatchUnknown();
+            }
+        }
+        bench::report("registry", throws, watch.seconds());
+        printCounts();
+    }
+
+    {
+        resetCounts();
+        bench::Stopwatch watch;
+        for (std::uint64_t i = 0; i < throws; ++i) {
+            try {
+                throwKind(static_cast<int>(i % kKinds));
+            } catch (...) {
+                handlers.dispatch(std::current_exception());
+            }
+        }
+        bench::report("registry (ptr)", throws, watch.seconds());
+        printCounts();
+    }
+
+    {
+        // The objects behind the first seven kinds, caught once; int has no std::exception to dispatch.
+        std::vector<std::exception_ptr> caught;
+        std::vector<const std::exception*> objects;
+        for (int kind = 0; kind < 7; ++kind) {
+            try {
+                throwKind(kind);
+            } catch (const std::exception& e) {
+                caught.push_back(std::current_exception());
+                objects.push_back(&e);
+            }
+        }
+        resetCounts();
+        const std::uint64_t dispatches = throws * 100;
+        bench::Stopwatch watch;
+        for (std::uint64_t i = 0; i < dispatches; ++i) {
+            handlers.dispatch(*objects[i % objects.size()]);
+        }
+        bench::report("dispatch only", dispatches, watch.seconds());
+        printCounts();
+    }
+    return 0;
+}
@@ -0,0 +1,91 @@
+#include <atomic>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "bank_account.h"
+#include "bench_util.h"
+#include "exception_log.h"
+
+// Simulated error storm: every withdrawal fails with InsufficientFundsException and the catch block logs it.
+//  - "log every exception": what main() does, one std::endl terminated line per exception
+//  - "ExceptionLog":        token bucket per site and type (10 lines/s, burst 20), counts the rest
+// Lines go to /dev/null, so this measures formatting and write calls, not a terminal.
+//
+// Usage: ExceptionLogBench [failures per thread] [threads]
+
+namespace {
+
+// Like the catch blocks in main(), plus a lock per line so threads do not interleave characters.
+void logEveryException(std::ostream& out, std::mutex& outMutex, std::uint64_t failures) {
+    BankAccount account;
+    for (std::uint64_t i = 0; i < failures; ++i) {
+        try {
+            account.withdraw(10.0);
+        } catch (const std::runtime_error& e) {
+            std::lock_guard<std::mutex> lock(outMutex);
+            out << "Runtime error: " << e.what() << std::endl;
+        }
+    }
+}
+
+// Same as LOG_CAUGHT_EXCEPTION, spelled out to count the lines that were written.
+void logRateLimited(ExceptionLog& log, std::atomic<std::uint64_t>& written, std::uint64_t failures) {
+    static ExceptionLogSite site(__FILE__, __LINE__);
+    BankAccount account;
+    for (std::uint64_t i = 0; i < failures; ++i) {
+        try {
+            account.withdraw(10.0);
+        } catch (const std::runtime_error& e) {
+            if (log.log(site, e)) {
+                written.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+}
+
+template <typename Worker>
+double run(unsigned threads, Worker worker) {
+    bench::Stopwatch watch;
+    std::vector<std::thread> pool;
+    for (unsigned t = 0; t < threads; ++t) {
+        pool.emplace_back(worker);
+    }
+    for (auto& thread : pool) {
+        thread.join();
+    }
+    return watch.seconds();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const std::uint64_t failures = bench::argOr(argc, argv, 1, 200'000);
+    const auto threads = static_cast<unsigned>(bench::argOr(argc, argv, 2, 4));
+    const std::uint64_t total = failures * threads;
+
+    std::ofstream devNull("/dev/null");
+    std::mutex outMutex;
+    const double every = run(threads, [&] { logEveryException(devNull, outMutex, failures); });
+    bench::report("log every exception", total, every);
+
+    ExceptionLog log(devNull);
+    std::atomic<std::uint64_t> written{0};
+    const double limited = run(threads, [&] { logRateLimited(log, written, failures); });
+    log.flushSuppressed();
+    bench::report("ExceptionLog (10 lines/s per site)", total, limited);
+    std::printf("lines written: %llu of %llu exceptions, the rest went into summary lines\n",
+                static_cast<unsigned long long>(written.load()), static_cast<unsigned long long>(total));
+
+    // The log decision alone, without the cost of throwing: the same site hit in a tight loop.
+    ExceptionLog decisionLog(devNull);
+    const InsufficientFundsException storm(10.0, 0.0);
+    const double decision = run(threads, [&] {
+        for (std::uint64_t i = 0; i < failures * 10; ++i) {
+            LOG_CAUGHT_EXCEPTION(decisionLog, storm);
+        }
+    });
+    bench::report("ExceptionLog decision only", total * 10, decision);
+    return 0;
+}
@@ -0,0 +1,78 @@
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "bench_util.h"
+#include "idempotency.h"
+
+// IdempotencyCache (idempotency.h) in front of tryDeposit(), against tryDeposit() alone.
+//   no keys        plain tryDeposit() on 1024 accounts
+//   new keys       every request has a new random key (the common case: only the Bloom filters are checked)
+//   10% retries    one request in ten repeats a recent key; the balance check below shows they were not applied
+// One tick per request, generations of 1M ticks with room for 1M keys each.
+//
+// Usage: IdempotencyBench [requests, default 20000000]
+
+int main(int argc, char** argv) {
+    const std::uint64_t requests = bench::argOr(argc, argv, 1, 20'000'000);
+    constexpr std::size_t kAccounts = 1024;
+    constexpr std::size_t kKeysPerGeneration = 1'000'000;
+
+    {
+        std::vector<BankAccount> accounts(kAccounts);
+        std::uint64_t ok = 0;
+        bench::Stopwatch watch;
+        for (std::uint64_t i = 0; i < requests; ++i) {
+            ok += accounts[i % kAccounts].tryDeposit(1.0) == AccountStatus::Ok;
+        }
+        bench::report("no keys", requests, watch.seconds());
+        bench::doNotOptimize(ok);
+    }
+
+    {
+        std::vector<BankAccount> accounts(kAccounts);
+        IdempotencyCache cache(kKeysPerGeneration, kKeysPerGeneration);
+        std::mt19937_64 rng(3);
+        std::uint64_t ok = 0;
+        bench::Stopwatch watch;
+        for (std::uint64_t i = 0; i < requests; ++i) {
+            ok += cache.tryDeposit(accounts[i % kAccounts], 1.0, rng() | 1, i) == AccountStatus::Ok;
+        }
+        bench::report("new keys", requests, watch.seconds());
+        bench::doNotOptimize(ok);
+        std::printf("  Bloom false positives %.4f%%, memory %.1f MB = %.1f bytes per key and generation\n",
+                    100.0 * static_cast<double>(cache.falsePositives()) / static_cast<double>(requests),
+                    static_cast<double>(cache.bytes()) / 1e6,
+                    static_cast<double>(cache.bytes()) / 2.0 / kKeysPerGeneration);
+    }
+
+    {
+        std::vector<BankAccount> accounts(kAccounts);
+        IdempotencyCache cache(kKeysPerGeneration, kKeysPerGeneration);
+        std::mt19937_64 rng(4);
+        std::vector<std::uint64_t> recent(4096);
+        std::uint64_t applied = 0;
+        bench::Stopwatch watch;
+        for (std::uint64_t i = 0; i < requests; ++i) {
+            std::uint64_t key;
+            if (i >= recent.size() && rng() % 10 == 0) {
+                key = recent[rng() % recent.size()];   // a retry of one of the last 4096 requests
+            } else {
+                key = rng() | 1;
+                recent[i % recent.size()] = key;
+                ++applied;
+            }
+            // The account follows from the key, as it would for a real retry.
+            cache.tryDeposit(accounts[key % kAccounts], 1.0, key, i);
+        }
+        bench::report("10% retries", requests, watch.seconds());
+        double total = 0.0;
+        for (const BankAccount& account : accounts) {
+            total += account.getBalance();
+        }
+        std::printf("  %llu retries answered from the cache, deposited %.0f for %llu distinct keys\n",
+                    static_cast<unsigned long long>(cache.duplicates()), total,
+                    static_cast<unsigned long long>(applied));
+    }
+    return 0;
+}
@@ -0,0 +1,95 @@
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+
+#include "bench_util.h"
+#include "journal_replay.h"
+
+// Journal replay at startup (journal_replay.h): sequential against parallel, on a journal written by JournalWriter.
+//
+// The journal opens the accounts and then has random deposits and withdrawals of 1 to 100 on them, with the outcome
+// and balance recorded from a live AccountRegistry. Withdrawals are a little more frequent than deposits, so many
+// fail with insufficient funds, and replay has to get each of those right. Every parallel replay is compared with
+// the sequential one (same_replay()), and each replay must find no mismatch with the recorded outcomes.
+// The file is read from the page cache, as right after it was written; a cold start adds the disk reads.
+//
+// Replay throughput can only grow with the number of cores: on a machine with one core, more threads add
+// the cost of the split step and nothing else.
+//
+// Usage: JournalReplayBench [directory for the journal file, default .] [records, default 20000000]
+//                           [accounts, default 1000000]
+
+namespace {
+
+void writeJournal(const std::string& path, std::uint64_t records, std::uint64_t accounts) {
+    const std::unique_ptr<JournalWriter> writer = openJournal(path);
+    AccountRegistry live(accounts);
+    std::mt19937_64 rng(13);
+    for (std::uint64_t i = 0; i < records; ++i) {
+        JournalRecord record{};
+        if (i < accounts) {
+            record.account = i * 7919;   // spread out, not 0, 1, 2, ...
+            record.amount = 50.0;
+            record.op = JournalOp::Open;
+            record.status = static_cast<std::uint8_t>(live.open(record.account, record.amount) ? ReplyStatus::Ok
+                                                                                               : ReplyStatus::AccountExists);
+        } else {
+            const std::uint64_t random = rng();
+            record.account = (random % accounts) * 7919;
+            record.amount = static_cast<double>((random >> 32) % 100 + 1);
+            const bool withdraw = (random >> 48) % 100 < 55;
+            record.op = withdraw ? JournalOp::Withdraw : JournalOp::Deposit;
+            const AccountStatus status = withdraw ? live.tryWithdraw(record.account, record.amount)
+                                                  : live.tryDeposit(record.account, record.amount);
+            record.status = static_cast<std::uint8_t>(toReplyStatus(status));
+        }
+        record.balanceAfter = *live.findBalance(record.account);
+        writer->append(record);
+    }
+    writer->commit();
+}
+
+void print(const char* name, const JournalReplay& replay, std::size_t records, double seconds) {
+    std::printf("%-26s %8.1f M records/s (%.2f s), %zu accounts, %zu ok, %zu insufficient funds, %zu mismatches\n",
+                name, static_cast<double>(records) / 1e6 / seconds, seconds, replay.accounts(), replay.stats.ok,
+                replay.stats.insufficientFunds, replay.stats.mismatches);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const std::string directory = argc > 1 ? argv[1] : ".";
+    const std::uint64_t records = bench::argOr(argc, argv, 2, 20'000'000);
+    const std::uint64_t accounts = std::min<std::uint64_t>(bench::argOr(argc, argv, 3, 1'000'000), records);
+    const std::string path = directory + "/journal_replay_bench.journal";
+
+    writeJournal(path, records, accounts);
+    {
+        const MappedJournal journal(path);
+        std::printf("journal: %zu records, %.0f MB\n", journal.size(),
+                    static_cast<double>(journal.size() * sizeof(JournalRecord)) / 1e6);
+
+        bench::Stopwatch sequentialWatch;
+        const JournalReplay sequential = replay_journal_sequential(journal);
+        print("sequential", sequential, journal.size(), sequentialWatch.seconds());
+
+        const std::size_t hardware = std::max(1u, std::thread::hardware_concurrency());
+        for (std::size_t threads = 1; threads <= std::max<std::size_t>(hardware, 4); threads *= 2) {
+            bench::Stopwatch watch;
+            const JournalReplay parallel = replay_journal_parallel(journal, threads);
+            const double seconds = watch.seconds();
+            const std::string name = "parallel, " + std::to_string(threads) + " threads";
+            print(name.c_str(), parallel, journal.size(), seconds);
+            if (!same_replay(parallel, sequential)) {
+                std::printf("  differs from sequential replay\n");
+            }
+        }
+    }
+    ::unlink(path.c_str());
+    return 0;
+}
@@ -0,0 +1,106 @@
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bank_account.h"
+#include "bench_util.h"
+#include "shared_account_store.h"
+
+// SharedAccountStore used by several processes at once, against the single-process BankAccount.
+// Every worker does the same deposit + withdraw mix on random accounts through the non-throwing functions.
+// The shared numbers are total operations per second of all processes together (wall clock).
+// Then one child process dies while it holds an account lock, and the parent checks it can still use the account.
+//
+// Usage: SharedAccountStoreBench [accounts, default 100000] [operations, default 10000000]
+
+namespace {
+
+void bankAccountLoop(std::size_t accounts, std::uint64_t operations) {
+    std::vector<BankAccount> bank(accounts);
+    std::mt19937_64 rng(1);
+    bench::Stopwatch watch;
+    for (std::uint64_t i = 0; i < operations / 2; ++i) {
+        BankAccount& account = bank[rng() % accounts];
+        account.tryDeposit(1.0);
+        account.tryWithdraw(2.0);
+    }
+    bench::report("BankAccount, 1 process", operations, watch.seconds());
+    bench::doNotOptimize(bank.front());
+}
+
+void sharedWorker(const std::string& name, std::uint32_t seed, std::uint64_t operations) {
+    SharedAccountStore store = SharedAccountStore::open(name);
+    std::mt19937_64 rng(seed);
+    const std::uint32_t accounts = store.capacity();
+    for (std::uint64_t i = 0; i < operations / 2; ++i) {
+        const auto account = static_cast<std::uint32_t>(rng() % accounts);
+        store.tryDeposit(account, 1.0);
+        store.tryWithdraw(account, 2.0);
+    }
+}
+
+void sharedLoop(const std::string& name, unsigned processes, std::uint64_t operations) {
+    bench::Stopwatch watch;
+    std::vector<pid_t> children;
+    for (unsigned p = 0; p < processes; ++p) {
+        const pid_t pid = ::fork();
+        if (pid == 0) {
+            sharedWorker(name, p + 1, operations / processes);
+            std::_Exit(0);
+        }
+        children.push_back(pid);
+    }
+    for (pid_t pid : children) {
+        ::waitpid(pid, nullptr, 0);
+    }
+    char label[64];
+    std::snprintf(label, sizeof label, "SharedAccountStore, %u process%s", processes, processes == 1 ? "" : "es");
+    bench::report(label, operations, watch.seconds());
+}
+
+void crashedHolder(SharedAccountStore& store) {
+    store.tryDeposit(0, 100.0);
+    const pid_t pid = ::fork();
+    if (pid == 0) {
+        // Die in the middle of an operation, without unlocking.
+        store.withLocked(0, [](double& balance) {
+            balance += 1.0;
+            std::_Exit(1);
+        });
+    }
+    ::waitpid(pid, nullptr, 0);
+
+    // Without a robust mutex this would wait forever.
+    const double balance = store.getBalance(0);
+    const AccountStatus status = store.tryWithdraw(0, 1.0);
+    std::printf("after a crashed lock holder: balance %.2f, withdraw %s, %llu lock(s) recovered\n", balance,
+                status == AccountStatus::Ok ? "ok" : "failed",
+                static_cast<unsigned long long>(store.recoveredLocks()));
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const auto accounts = static_cast<std::uint32_t>(bench::argOr(argc, argv, 1, 100'000));
+    const std::uint64_t operations = bench::argOr(argc, argv, 2, 10'000'000);
+    std::printf("%u accounts, %ld CPUs\n", accounts, ::sysconf(_SC_NPROCESSORS_ONLN));
+
+    bankAccountLoop(accounts, operations);
+
+    const std::string name = "/eh_shared_accounts_" + std::to_string(::getpid());
+    SharedAccountStore store = SharedAccountStore::create(name, accounts);
+    for (std::uint32_t account = 0; account < accounts; ++account) {
+        store.tryDeposit(account, 100.0);
+    }
+    for (unsigned processes : {1u, 2u, 4u, 8u}) {
+        sharedLoop(name, processes, operations);
+    }
+    crashedHolder(store);
+    SharedAccountStore::remove(name);
+    return 0;
+}
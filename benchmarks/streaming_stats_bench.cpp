@@ -0,0 +1,66 @@
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "bench_util.h"
+#include "streaming_stats.h"
+
+// Insert throughput of StreamingStats (Welford + KLL sketch) compared with the plain running sum
+// that calculate_avg() style code would use. Also prints the quantile error against exact values.
+
+int main(int argc, char** argv) {
+    const std::uint64_t n = bench::argOr(argc, argv, 1, 50'000'000);
+
+    std::mt19937_64 rng(42);
+    std::lognormal_distribution<double> latency(3.0, 0.8);
+    std::vector<double> values(1 << 20);
+    for (double& v : values) {
+        v = latency(rng);
+    }
+    const std::size_t mask = values.size() - 1;
+
+    {
+        double sum = 0.0;
+        bench::Stopwatch watch;
+        for (std::uint64_t i = 0; i < n; ++i) {
+            sum += values[i & mask];
+        }
+        bench::doNotOptimize(sum);
+        bench::report("running sum (mean only)", n, watch.seconds());
+    }
+
+    StreamingStats stats;
+    {
+        bench::Stopwatch watch;
+        for (std::uint64_t i = 0; i < n; ++i) {
+            stats.insert(values[i & mask]);
+        }
+        bench::report("StreamingStats::insert", n, watch.seconds());
+    }
+
+    {
+        // Four shards, as four threads would produce them, merged at the end.
+        std::vector<StreamingStats> shards(4);
+        bench::Stopwatch watch;
+        for (std::uint64_t i = 0; i < n; ++i) {
+            shards[i & 3].insert(values[i & mask]);
+        }
+        StreamingStats merged;
+        for (const auto& shard : shards) {
+            merged.merge(shard);
+        }
+        bench::report("4 shards + merge", n, watch.seconds());
+        std::printf("merged p99 %.3f vs single p99 %.3f\n", merged.p99(), stats.p99());
+    }
+
+    std::vector<double> sorted(values);
+    std::sort(sorted.begin(), sorted.end());
+    for (double q : {0.5, 0.9, 0.99}) {
+        const double exact = sorted[static_cast<std::size_t>(q * static_cast<double>(sorted.size() - 1))];
+        std::printf("q=%.2f exact %.3f sketch %.3f\n", q, exact, stats.quantile(q));
+    }
+    std::printf("mean %.3f stddev %.3f min %.3f max %.3f over %llu values\n",
+                stats.mean(), stats.stddev(), stats.min(), stats.max(),
+                static_cast<unsigned long long>(stats.count()));
+    return 0;
+}
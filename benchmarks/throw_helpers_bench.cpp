@@ -0,0 +1,106 @@
+#include <stdexcept>
+
+#include "average.h"
+#include "bank_account.h"
+#include "bench_util.h"
+
+// Hot loop of calculate_avg(), deposit() and withdraw() where nothing fails,
+// once with the throw expression written inside the function ("inline throw", the code before throw_helpers.h)
+// and once with the cold throw helpers the project uses now.
+// The functions are noinline so they keep their own symbol: code_size_report.sh prints their size from this binary.
+
+namespace inline_throw {
+
+[[gnu::noinline]] double calculate_avg(int sum, int total) {
+    if (total == 0) {
+        throw DivideByZeroException();
+    }
+    if (sum < 0 || total < 0) {
+        throw NegativeValueException();
+    }
+    return static_cast<double>(sum) / total;
+}
+
+[[gnu::noinline]] void deposit(double& balance, double amount) {
+    if (amount <= 0.0) {
+        throw std::invalid_argument("Invalid deposit amount");
+    }
+    balance += amount;
+}
+
+[[gnu::noinline]] void withdraw(double& balance, double amount) {
+    if (amount <= 0.0) {
+        throw std::invalid_argument("Invalid withdrawal amount");
+    }
+    if (amount > balance) {
+        throw std::runtime_error("Insufficient funds");
+    }
+    balance -= amount;
+}
+
+} // namespace inline_throw
+
+namespace cold_helpers {
+
+[[gnu::noinline]] double calculate_avg(int sum, int total) {
+    return ::calculate_avg(sum, total);
+}
+
+[[gnu::noinline]] void deposit(double& balance, double amount) {
+    if (amount <= 0.0) {
+        throw_invalid_amount("Invalid deposit amount", amount);
+    }
+    balance += amount;
+}
+
+[[gnu::noinline]] void withdraw(double& balance, double amount) {
+    if (amount <= 0.0) {
+        throw_invalid_amount("Invalid withdrawal amount", amount);
+    }
+    if (amount > balance) {
+        throw_insufficient_funds(amount, balance);
+    }
+    balance -= amount;
+}
+
+// BankAccount itself, to include its printing path in the size report.
+[[gnu::noinline]] void account_withdraw(BankAccount& account, double amount) {
+    account.withdraw(amount);
+}
+
+} // namespace cold_helpers
+
+namespace {
+
+template <typename Avg, typename Deposit, typename Withdraw>
+void hotLoop(const char* name, std::uint64_t n, Avg avg, Deposit deposit, Withdraw withdraw) {
+    double balance = 0.0;
+    double avgSum = 0.0;
+    bench::Stopwatch watch;
+    for (std::uint64_t i = 0; i < n; ++i) {
+        avgSum += avg(static_cast<int>(i & 1023), 7);
+        deposit(balance, 2.0);
+        withdraw(balance, 1.0);
+    }
+    bench::doNotOptimize(avgSum);
+    bench::doNotOptimize(balance);
+    bench::report(name, n * 3, watch.seconds());
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const std::uint64_t n = bench::argOr(argc, argv, 1, 100'000'000);
+    for (int round = 0; round < 2; ++round) {
+        hotLoop("inline throw (avg + deposit + withdraw)", n,
+                inline_throw::calculate_avg, inline_throw::deposit, inline_throw::withdraw);
+        hotLoop("cold helpers (avg + deposit + withdraw)", n,
+                cold_helpers::calculate_avg, cold_helpers::deposit, cold_helpers::withdraw);
+    }
+
+    bench::silenceCout();
+    BankAccount account;
+    account.deposit(1.0);
+    cold_helpers::account_withdraw(account, 0.5);
+    return 0;
+}
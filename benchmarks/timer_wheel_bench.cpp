@@ -0,0 +1,89 @@
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "bench_util.h"
+#include "timer_wheel.h"
+
+// TimerWheel (timer_wheel.h) with millions of outstanding standing orders.
+//
+// All timers are recurring, with a period between 2^10 and 2^20 ticks and a first due tick in the next 2^20 ticks,
+// spread over 65536 accounts. Three deposits of 10 for every withdrawal of 30, so some withdrawals fail and
+// show up in the failure lists of their batches.
+//   schedule   the outstanding timers
+//   cancel     10% of them, at random
+//   refill     schedule as many again (cancelled entries are reused only after time reaches their slots)
+//   fire       advance 2^20 ticks; every fired timer is scheduled again by its period
+//
+// Usage: TimerWheelBench [outstanding timers, default 10000000]
+
+int main(int argc, char** argv) {
+    const std::uint64_t timers = bench::argOr(argc, argv, 1, 10'000'000);
+    constexpr std::size_t kAccounts = 65536;
+    constexpr std::uint64_t kTicks = 1 << 20;
+
+    std::vector<BankAccount> accounts(kAccounts);
+    std::mt19937_64 rng(7);
+    TimerWheel wheel;
+    wheel.reserve(timers + timers / 10);   // room for the refill, cancelled entries are not reused yet
+    std::vector<TimerId> ids(timers);
+
+    auto scheduleOne = [&] {
+        const std::uint64_t due = 1 + rng() % (kTicks - 1);
+        const auto period = static_cast<std::uint32_t>(1024 + rng() % (kTicks - 1024));
+        BankAccount& account = accounts[rng() % kAccounts];
+        const bool withdraw = rng() % 4 == 0;
+        return wheel.schedule(due, account, withdraw ? ScheduledOp::Withdraw : ScheduledOp::Deposit,
+                              withdraw ? 30.0 : 10.0, period);
+    };
+
+    {
+        bench::Stopwatch watch;
+        for (std::uint64_t i = 0; i < timers; ++i) {
+            ids[i] = scheduleOne();
+        }
+        bench::report("schedule", timers, watch.seconds());
+    }
+
+    const std::uint64_t cancels = timers / 10;
+    std::vector<std::uint64_t> victims(cancels);
+    for (auto& victim : victims) {
+        victim = rng() % timers;
+    }
+    {
+        std::uint64_t cancelled = 0;
+        bench::Stopwatch watch;
+        for (std::uint64_t victim : victims) {
+            cancelled += wheel.cancel(ids[victim]);
+        }
+        bench::report("cancel (random)", cancels, watch.seconds());
+        std::printf("  cancelled %llu (the rest were picked twice)\n", static_cast<unsigned long long>(cancelled));
+    }
+
+    {
+        const std::uint64_t refill = timers - wheel.pending();
+        bench::Stopwatch watch;
+        for (std::uint64_t i = 0; i < refill; ++i) {
+            bench::doNotOptimize(scheduleOne());
+        }
+        bench::report("refill", refill, watch.seconds());
+    }
+    std::printf("  outstanding %zu\n", wheel.pending());
+
+    {
+        std::uint64_t fired = 0;
+        std::uint64_t failed = 0;
+        std::uint64_t batches = 0;
+        bench::Stopwatch watch;
+        wheel.advance(kTicks, [&](const FiredBatch& batch) {
+            fired += batch.fired;
+            failed += batch.failures.size();
+            ++batches;
+        });
+        bench::report("fire (incl. cascades and rescheduling)", fired, watch.seconds());
+        std::printf("  %llu batches, %llu fired, %llu failed, outstanding %zu\n",
+                    static_cast<unsigned long long>(batches), static_cast<unsigned long long>(fired),
+                    static_cast<unsigned long long>(failed), wheel.pending());
+    }
+    return 0;
+}
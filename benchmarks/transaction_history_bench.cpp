@@ -0,0 +1,95 @@
+#include <cstdio>
+#include <ostream>
+#include <random>
+#include <streambuf>
+#include <vector>
+
+#include "bench_util.h"
+#include "transaction_history.h"
+
+// TransactionHistory (transaction_history.h): size of the encoded history, and statement export.
+//
+// The history has one transaction per millisecond or so (timestamps grow by 0-2 per row), on 1M accounts,
+// with amounts in whole cents up to 1000.00.
+// "transactions read" counts the rows of the blocks read, "MB/s of CSV" the statement written. Statements are
+// written as CSV into a stream that only counts bytes, so the numbers are the cost of the history and the
+// formatting, not of a disk.
+//   append                   all transactions
+//   statement: one account   all time: only the account column of every block is decoded
+//   export: 1% of the time   all accounts in a time range: min/max timestamps skip the other blocks
+//   statement: account, 1%   one account in that time range
+//
+// Usage: TransactionHistoryBench [transactions, default 20000000]
+
+namespace {
+
+// Counts what is written and throws it away.
+class CountingBuffer : public std::streambuf {
+public:
+    std::size_t count = 0;
+
+protected:
+    std::streamsize xsputn(const char*, std::streamsize n) override {
+        count += static_cast<std::size_t>(n);
+        return n;
+    }
+    int_type overflow(int_type c) override {
+        ++count;
+        return c;
+    }
+};
+
+void exportStatement(const char* name, const TransactionHistory& history, const HistoryQuery& query) {
+    CountingBuffer buffer;
+    std::ostream out(&buffer);
+    bench::Stopwatch watch;
+    const HistoryScanStats stats = history.writeStatement(out, query);
+    const double seconds = watch.seconds();
+    std::printf("%-26s %9zu rows, %5zu blocks read, %5zu skipped: %8.2f ms, %6.1f M transactions/s read, "
+                "%6.1f MB/s of CSV\n", name, stats.rows, stats.blocksRead, stats.blocksSkipped, seconds * 1e3,
+                static_cast<double>(stats.blocksRead * TransactionHistory::kBlockRows) / 1e6 / seconds,
+                static_cast<double>(buffer.count) / 1e6 / seconds);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const std::uint64_t transactions = bench::argOr(argc, argv, 1, 20'000'000);
+    constexpr std::uint64_t kAccounts = 1'000'000;
+
+    // Generated first, so that append only measures the history.
+    std::vector<HistoryRow> rows(transactions);
+    std::mt19937_64 rng(9);
+    const std::uint64_t start = 1'700'000'000'000;
+    std::uint64_t timestamp = start;
+    for (HistoryRow& row : rows) {
+        timestamp += rng() % 3;
+        const std::uint64_t random = rng();
+        row.account = (random >> 1) % kAccounts;
+        row.timestamp = timestamp;
+        row.op = random & 1 ? HistoryOp::Deposit : HistoryOp::Withdraw;
+        row.amount = static_cast<double>((random >> 40) % 100'000 + 1) / 100.0;
+    }
+
+    TransactionHistory history;
+    {
+        bench::Stopwatch watch;
+        for (const HistoryRow& row : rows) {
+            history.append(row.account, row.timestamp, row.op, row.amount);
+        }
+        bench::report("append", transactions, watch.seconds());
+    }
+    rows = {};
+    std::printf("  %.1f MB for %zu transactions: %.2f bytes per transaction (%zu unencoded)\n",
+                static_cast<double>(history.bytes()) / 1e6, history.size(),
+                static_cast<double>(history.bytes()) / static_cast<double>(history.size()),
+                2 * sizeof(std::uint64_t) + sizeof(HistoryOp) + sizeof(double));
+
+    const std::uint64_t span = timestamp - start;
+    const HistoryQuery lastPercent{HistoryQuery::kAllAccounts, start + span / 2, start + span / 2 + span / 100};
+    exportStatement("statement: one account", history, {12345});
+    exportStatement("export: 1% of the time", history, lastPercent);
+    exportStatement("statement: account, 1%", history, {12345, lastPercent.from, lastPercent.to});
+    exportStatement("export: everything", history, {});
+    return 0;
+}
@@ -0,0 +1,98 @@
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "bank_account.h"
+#include "bench_util.h"
+
+// Velocity limits (VelocityLimit, account_policies.h) in the withdrawal path, against BankAccount without them
+// and against a "padded" account: as large as the velocity account (32 bytes) but without the check, to tell the
+// cost of the larger account from the cost of the check.
+// The velocity account allows 10 withdrawals or 1000 per minute, with one VelocityClock tick per second.
+//   many accounts   tryWithdraw(1.0) on random accounts (10M): nearly every operation is a cache miss, with or
+//                   without the counters (they are in the same cache line as the balance)
+//     independent   the next account does not depend on this operation, so the CPU overlaps several misses;
+//                   how many depends on the instructions per operation, which the check adds to
+//     dependent     the next account depends on the balance after this operation: one miss after the other,
+//                   as for a single request, so this is the latency per operation
+//   1024 accounts   independent operations on accounts that stay in the cache: the cost of the check itself,
+//                   with most withdrawals rejected by the limit
+// Simulated time moves one second per 100000 operations; the account indices are drawn before the clock starts.
+//
+// Usage: VelocityLimitBench [operations, default 20000000] [accounts, default 10000000]
+
+namespace {
+
+using VelocityAccount = BasicAccount<NoOverdraft, NoLimit, PositiveAmount, VelocityLimit<10, 1000.0>>;
+
+// A VelocityPolicy that allows everything and takes the space of VelocityLimit.
+struct Padding {
+    constexpr bool allows(double) const noexcept { return true; }
+    constexpr void record(double) noexcept {}
+    constexpr unsigned withdrawals() const noexcept { return 0; }
+    constexpr double withdrawn() const noexcept { return 0.0; }
+    char bytes[24];
+};
+
+using PaddedAccount = BasicAccount<NoOverdraft, NoLimit, PositiveAmount, Padding>;
+
+// dependent: the next index is XORed with a value computed from the balance (always 0, the CPU cannot know).
+template <typename Account>
+void run(const char* name, const std::vector<std::uint32_t>& indices, std::size_t accountCount, bool dependent) {
+    std::vector<Account> accounts(accountCount);
+    for (Account& account : accounts) {
+        account.tryDeposit(1e9);
+    }
+    VelocityClock::set(0);
+    std::uint64_t ok = 0;
+    std::uint64_t rejected = 0;
+    std::uint32_t previous = 0;
+    bench::Stopwatch watch;
+    for (std::size_t i = 0; i < indices.size(); ++i) {
+        if (i % 100'000 == 0) {
+            VelocityClock::set(static_cast<std::uint32_t>(i / 100'000));
+        }
+        Account& account = accounts[indices[i] ^ previous];
+        const AccountStatus status = account.tryWithdraw(1.0);
+        ok += status == AccountStatus::Ok;
+        rejected += status == AccountStatus::VelocityExceeded;
+        if (dependent) {
+            previous = account.getBalance() < 0.0;
+        }
+    }
+    bench::report(name, indices.size(), watch.seconds());
+    std::printf("  %llu ok, %llu rejected by the velocity limit\n", static_cast<unsigned long long>(ok),
+                static_cast<unsigned long long>(rejected));
+}
+
+std::vector<std::uint32_t> randomIndices(std::uint64_t count, std::size_t accounts) {
+    std::mt19937_64 rng(11);
+    std::vector<std::uint32_t> indices(count);
+    for (std::uint32_t& index : indices) {
+        index = static_cast<std::uint32_t>(rng() % accounts);
+    }
+    return indices;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const std::uint64_t operations = bench::argOr(argc, argv, 1, 20'000'000);
+    const std::size_t accounts = bench::argOr(argc, argv, 2, 10'000'000);
+    std::printf("sizeof BankAccount %zu, PaddedAccount %zu, VelocityAccount %zu\n",
+                sizeof(BankAccount), sizeof(PaddedAccount), sizeof(VelocityAccount));
+
+    const std::vector<std::uint32_t> many = randomIndices(operations, accounts);
+    run<BankAccount>("many accounts, independent: BankAccount", many, accounts, false);
+    run<PaddedAccount>("many accounts, independent: padded", many, accounts, false);
+    run<VelocityAccount>("many accounts, independent: velocity limit", many, accounts, false);
+    run<BankAccount>("many accounts, dependent: BankAccount", many, accounts, true);
+    run<PaddedAccount>("many accounts, dependent: padded", many, accounts, true);
+    run<VelocityAccount>("many accounts, dependent: velocity limit", many, accounts, true);
+
+    constexpr std::size_t kHotAccounts = 1024;
+    const std::vector<std::uint32_t> hot = randomIndices(operations, kHotAccounts);
+    run<BankAccount>("1024 accounts: BankAccount", hot, kHotAccounts, false);
+    run<VelocityAccount>("1024 accounts: velocity limit", hot, kHotAccounts, false);
+    return 0;
+}
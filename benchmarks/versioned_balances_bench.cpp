@@ -0,0 +1,153 @@
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "bench_util.h"
+#include "versioned_balances.h"
+
+// Snapshots for reports (versioned_balances.h): what they cost the writers, and how much memory an old snapshot holds.
+//   write path      random deposits on a plain array, on one with the stripe locks of VersionedBalances,
+//                   and on VersionedBalances without a snapshot and with a new one for every step of writes
+//   snapshot age    one snapshot stays pinned while the writes go on: time per write and versions kept,
+//                   by the number of writes since the snapshot was taken
+//   reports         a report thread takes snapshots and adds up all balances while a writer moves money between
+//                   accounts (a withdrawal and then a deposit of 1); every total must be one the writer actually
+//                   had, the starting total or one less
+// On a machine with a single core the two threads of the last part take turns, so only its consistency check says
+// much there.
+//
+// Usage: VersionedBalancesBench [accounts, default 1000000] [writes per step, default 1000000]
+
+int main(int argc, char** argv) {
+    const std::size_t accounts = bench::argOr(argc, argv, 1, 1'000'000);
+    const std::size_t step = bench::argOr(argc, argv, 2, 1'000'000);
+    constexpr int kSteps = 8;
+
+    // Random accounts, different ones in every step.
+    std::mt19937_64 rng(11);
+    std::vector<std::vector<std::uint32_t>> steps(kSteps, std::vector<std::uint32_t>(step));
+    for (std::vector<std::uint32_t>& targets : steps) {
+        for (std::uint32_t& target : targets) {
+            target = static_cast<std::uint32_t>(rng() % accounts);
+        }
+    }
+
+    {
+        std::vector<double> plain(accounts, 100.0);
+        bench::Stopwatch watch;
+        for (const std::vector<std::uint32_t>& targets : steps) {
+            for (std::uint32_t target : targets) {
+                plain[target] += 1.0;
+            }
+        }
+        bench::report("write path: plain balance array", step * kSteps, watch.seconds());
+        bench::doNotOptimize(plain.data());
+    }
+    {
+        // The locking any store with concurrent writers needs, without the versions.
+        std::vector<double> plain(accounts, 100.0);
+        struct alignas(64) Stripe {
+            std::mutex mutex;
+        };
+        std::vector<Stripe> stripes(VersionedBalances::kStripes);
+        bench::Stopwatch watch;
+        for (const std::vector<std::uint32_t>& targets : steps) {
+            for (std::uint32_t target : targets) {
+                const std::lock_guard<std::mutex> lock(stripes[target % VersionedBalances::kStripes].mutex);
+                plain[target] += 1.0;
+            }
+        }
+        bench::report("write path: array with stripe locks", step * kSteps, watch.seconds());
+        bench::doNotOptimize(plain.data());
+    }
+    {
+        VersionedBalances balances(accounts, 100.0);
+        bench::Stopwatch watch;
+        for (const std::vector<std::uint32_t>& targets : steps) {
+            for (std::uint32_t target : targets) {
+                balances.tryDeposit(target, 1.0);
+            }
+        }
+        bench::report("write path: VersionedBalances, no snapshot", step * kSteps, watch.seconds());
+    }
+    {
+        VersionedBalances balances(accounts, 100.0);
+        std::optional<VersionedBalances::Snapshot> snapshot;
+        bench::Stopwatch watch;
+        for (const std::vector<std::uint32_t>& targets : steps) {
+            snapshot.reset();
+            snapshot.emplace(balances.snapshot());   // a new snapshot for each step
+            for (std::uint32_t target : targets) {
+                balances.tryDeposit(target, 1.0);
+            }
+        }
+        bench::report("write path: new snapshot every step", step * kSteps, watch.seconds());
+        std::printf("  %zu versions (%.1f MB) held by the last snapshot\n", balances.versions(),
+                    static_cast<double>(balances.versionBytes()) / 1e6);
+    }
+
+    {
+        std::printf("\n%-26s %10s %12s %10s %14s\n", "writes since snapshot", "ns/write", "versions", "MB",
+                    "bytes/account");
+        VersionedBalances balances(accounts, 100.0);
+        std::optional<VersionedBalances::Snapshot> snapshot(balances.snapshot());
+        const double before = snapshot->total();
+        for (int round = 1; round <= kSteps; ++round) {
+            bench::Stopwatch watch;
+            for (std::uint32_t target : steps[static_cast<std::size_t>(round - 1)]) {
+                balances.tryDeposit(target, 1.0);
+            }
+            const double seconds = watch.seconds();
+            std::printf("%-26zu %10.2f %12zu %10.1f %14.1f\n", step * static_cast<std::size_t>(round),
+                        seconds * 1e9 / static_cast<double>(step), balances.versions(),
+                        static_cast<double>(balances.versionBytes()) / 1e6,
+                        static_cast<double>(balances.versionBytes()) / static_cast<double>(accounts));
+        }
+        const bool unchanged = snapshot->total() == before;
+        bench::Stopwatch releaseWatch;
+        snapshot.reset();
+        const double releaseMs = releaseWatch.seconds() * 1e3;
+        std::printf("snapshot total unchanged: %s; release took %.1f ms, %zu versions left, %zu kept for reuse "
+                    "(%.1f MB)\n",
+                    unchanged ? "yes" : "NO", releaseMs, balances.versions(), balances.freeVersions(),
+                    static_cast<double>(balances.freeVersions() * 24) / 1e6);
+    }
+
+    {
+        VersionedBalances balances(accounts, 100.0);
+        const double start = 100.0 * static_cast<double>(accounts);
+        std::atomic<bool> stop{false};
+        std::uint64_t reports = 0;
+        std::uint64_t inconsistent = 0;
+        std::thread reporter([&] {
+            while (!stop.load(std::memory_order_relaxed)) {
+                const VersionedBalances::Snapshot snapshot = balances.snapshot();
+                const double total = snapshot.total();
+                inconsistent += total != start && total != start - 1.0;
+                ++reports;
+            }
+        });
+        std::uint64_t transfers = 0;
+        bench::Stopwatch watch;
+        for (const std::vector<std::uint32_t>& targets : steps) {
+            for (std::size_t i = 0; i + 1 < targets.size(); i += 2) {
+                if (balances.tryWithdraw(targets[i], 1.0) == AccountStatus::Ok) {
+                    balances.tryDeposit(targets[i + 1], 1.0);
+                }
+                ++transfers;
+            }
+        }
+        const double seconds = watch.seconds();
+        stop.store(true, std::memory_order_relaxed);
+        reporter.join();
+        std::printf("\n");
+        bench::report("transfers while reports run", transfers, seconds);
+        std::printf("  %llu reports, %llu inconsistent totals\n", static_cast<unsigned long long>(reports),
+                    static_cast<unsigned long long>(inconsistent));
+        return inconsistent == 0 ? 0 : 1;
+    }
+}
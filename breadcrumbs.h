@@ -0,0 +1,229 @@
+#ifndef EXCEPTIONHANDLING_BREADCRUMBS_H
+#define EXCEPTIONHANDLING_BREADCRUMBS_H
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Breadcrumbs: the last operations of this thread, for debugging a failure after the fact.
+//
+// Logging every deposit() and withdraw() costs far too much, but when a withdraw() fails we would like to know
+// what the thread did just before. Every BankAccount operation therefore leaves a 32-byte breadcrumb
+// (operation, account, amount, timestamp) in a thread_local ring of the last kBreadcrumbCapacity operations.
+// Only the owning thread writes its ring, so writing is a few plain stores: no lock, no atomic instruction.
+// The timestamp is the CPU's time stamp counter (rdtsc), which is cheaper to read than a clock.
+//
+// The ring keeps being overwritten, so it is copied when it matters:
+//  - every project exception (all of them are thrown by the helpers in throw_helpers.h) takes a snapshot just before
+//    it is thrown; the catch block gets it with last_breadcrumb_snapshot() and can print or save it,
+//  - install_breadcrumb_terminate_handler(path) writes the ring of the dying thread to a file on std::terminate.
+// Files are binary (header + records) and are decoded offline with tools/breadcrumb_decode.cpp.
+//
+// The account is identified by its address (BankAccount has no id).
+//
+// Breadcrumbs are off unless the program is compiled with EH_BREADCRUMBS=1 (set from CMake with
+// -DEXCEPTION_HANDLING_BREADCRUMBS=ON, for every file of the build: the value changes inline functions, so it must
+// be the same in all of them). Reading the time stamp counter is most of the cost of a cheap operation such as
+// tryDeposit() (see benchmarks/BreadcrumbBench and BreadcrumbOffBench), too much to pay in every build; turn them
+// on in the builds that need the history. Without them leave_breadcrumb() compiles to nothing and the snapshots
+// are empty.
+
+#ifndef EH_BREADCRUMBS
+#define EH_BREADCRUMBS 0
+#endif
+
+inline constexpr std::size_t kBreadcrumbCapacity = 256;   // power of two
+
+enum class BreadcrumbOp : std::uint8_t {
+    Deposit = 1,
+    Withdraw = 2,
+    TryDeposit = 3,
+    TryWithdraw = 4,
+};
+
+struct Breadcrumb {
+    std::uint64_t timestamp;   // time stamp counter ticks, see BreadcrumbFileHeader::ticksPerNanosecond
+    std::uint64_t account;     // address of the BankAccount
+    double amount;
+    BreadcrumbOp op;
+    std::uint8_t reserved[7];
+};
+
+static_assert(sizeof(Breadcrumb) == 32, "Breadcrumb is part of the dump format");
+
+enum class BreadcrumbReason : std::uint32_t {
+    Manual = 0,
+    Exception = 1,
+    Terminate = 2,
+};
+
+// The last breadcrumbs of a thread, oldest first.
+struct BreadcrumbSnapshot {
+    Breadcrumb crumbs[kBreadcrumbCapacity];
+    std::size_t count = 0;
+    std::uint64_t taken = 0;   // timestamp of the snapshot
+    BreadcrumbReason reason = BreadcrumbReason::Manual;
+};
+
+// Start of a breadcrumb file, followed by `count` Breadcrumb records, oldest first.
+struct BreadcrumbFileHeader {
+    char magic[8];             // "EHCRUMB1"
+    std::uint32_t recordSize;
+    BreadcrumbReason reason;
+    std::uint64_t count;
+    std::uint64_t taken;       // timestamp of the snapshot, ages are relative to it
+    double ticksPerNanosecond;
+};
+
+inline constexpr char kBreadcrumbMagic[8] = {'E', 'H', 'C', 'R', 'U', 'M', 'B', '1'};
+
+namespace breadcrumb_detail {
+
+struct Ring {
+    Breadcrumb crumbs[kBreadcrumbCapacity];
+    std::uint64_t next;   // total number of breadcrumbs written
+};
+
+inline thread_local constinit Ring ring{};
+inline thread_local constinit BreadcrumbSnapshot lastSnapshot{};
+// Filled by the terminate handler: not on the stack of a thread that may be out of stack, and one per thread,
+// because two threads can terminate at the same time.
+inline thread_local constinit BreadcrumbSnapshot terminateSnapshot{};
+
+inline std::uint64_t now() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+// Time stamp counter ticks per nanosecond, measured once against steady_clock (takes about 2 ms).
+inline double ticksPerNanosecond() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+    static const double ticks = [] {
+        const auto start = std::chrono::steady_clock::now();
+        const std::uint64_t startTicks = now();
+        while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(2)) {
+        }
+        const std::uint64_t endTicks = now();
+        const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        return static_cast<double>(endTicks - startTicks) / ns;
+    }();
+    return ticks;
+#else
+    return 1.0;
+#endif
+}
+
+inline void copyRing(BreadcrumbSnapshot& snapshot, BreadcrumbReason reason) noexcept {
+    const std::uint64_t next = ring.next;
+    const std::size_t count = next < kBreadcrumbCapacity ? static_cast<std::size_t>(next) : kBreadcrumbCapacity;
+    // Oldest first: the part after the write position, then the part before it.
+    const std::size_t start = static_cast<std::size_t>(next - count) & (kBreadcrumbCapacity - 1);
+    const std::size_t firstPart = count < kBreadcrumbCapacity - start ? count : kBreadcrumbCapacity - start;
+    std::memcpy(snapshot.crumbs, ring.crumbs + start, firstPart * sizeof(Breadcrumb));
+    std::memcpy(snapshot.crumbs + firstPart, ring.crumbs, (count - firstPart) * sizeof(Breadcrumb));
+    snapshot.count = count;
+    snapshot.taken = now();
+    snapshot.reason = reason;
+}
+
+inline char terminatePath[256] = {};
+inline std::terminate_handler previousTerminate = nullptr;
+
+} // namespace breadcrumb_detail
+
+// Record an operation on the calling thread's ring.
+inline void leave_breadcrumb(BreadcrumbOp op, const void* account, double amount) noexcept {
+#if EH_BREADCRUMBS
+    breadcrumb_detail::Ring& ring = breadcrumb_detail::ring;
+    Breadcrumb& crumb = ring.crumbs[ring.next & (kBreadcrumbCapacity - 1)];
+    crumb.timestamp = breadcrumb_detail::now();
+    crumb.account = reinterpret_cast<std::uintptr_t>(account);
+    crumb.amount = amount;
+    crumb.op = op;
+    ++ring.next;
+#else
+    (void)op;
+    (void)account;
+    (void)amount;
+#endif
+}
+
+// Copy of the calling thread's ring right now.
+inline void snapshot_breadcrumbs(BreadcrumbSnapshot& snapshot) noexcept {
+    breadcrumb_detail::copyRing(snapshot, BreadcrumbReason::Manual);
+}
+
+// Called by the throw helpers before a project exception is thrown.
+inline void snapshot_breadcrumbs_for_exception() noexcept {
+#if EH_BREADCRUMBS
+    breadcrumb_detail::copyRing(breadcrumb_detail::lastSnapshot, BreadcrumbReason::Exception);
+#endif
+}
+
+// The breadcrumbs of this thread at the time its last project exception was thrown.
+inline const BreadcrumbSnapshot& last_breadcrumb_snapshot() noexcept {
+    return breadcrumb_detail::lastSnapshot;
+}
+
+// Write a snapshot in the binary format of BreadcrumbFileHeader. Uses only open/write/close,
+// so it also works from a terminate handler. Returns false if the file could not be written.
+inline bool write_breadcrumbs(const char* path, const BreadcrumbSnapshot& snapshot) noexcept {
+    BreadcrumbFileHeader header{};
+    std::memcpy(header.magic, kBreadcrumbMagic, sizeof header.magic);
+    header.recordSize = sizeof(Breadcrumb);
+    header.reason = snapshot.reason;
+    header.count = snapshot.count;
+    header.taken = snapshot.taken;
+    header.ticksPerNanosecond = breadcrumb_detail::ticksPerNanosecond();
+
+    const int fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    const std::size_t recordBytes = snapshot.count * sizeof(Breadcrumb);
+    const bool ok = ::write(fd, &header, sizeof header) == static_cast<ssize_t>(sizeof header) &&
+                    ::write(fd, snapshot.crumbs, recordBytes) == static_cast<ssize_t>(recordBytes);
+    ::close(fd);
+    return ok;
+}
+
+namespace breadcrumb_detail {
+
+[[noreturn]] inline void onTerminate() {
+    BreadcrumbSnapshot& snapshot = terminateSnapshot;
+    copyRing(snapshot, BreadcrumbReason::Terminate);
+    write_breadcrumbs(terminatePath, snapshot);
+    if (previousTerminate != nullptr) {
+        previousTerminate();
+    }
+    std::abort();
+}
+
+} // namespace breadcrumb_detail
+
+// On std::terminate, write the breadcrumbs of the thread that terminates to path, then continue with the
+// terminate handler that was installed before (std::abort by default).
+// Calling it again only changes the path: our own handler is never chained to itself.
+inline void install_breadcrumb_terminate_handler(const char* path) {
+    std::strncpy(breadcrumb_detail::terminatePath, path, sizeof breadcrumb_detail::terminatePath - 1);
+    breadcrumb_detail::ticksPerNanosecond();   // measure now, not while terminating
+    const std::terminate_handler previous = std::set_terminate(breadcrumb_detail::onTerminate);
+    if (previous != breadcrumb_detail::onTerminate) {
+        breadcrumb_detail::previousTerminate = previous;
+    }
+}
+
+#endif //EXCEPTIONHANDLING_BREADCRUMBS_H
@@ -0,0 +1,152 @@
+#ifndef EXCEPTIONHANDLING_BULK_BALANCE_H
+#define EXCEPTIONHANDLING_BULK_BALANCE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "throw_helpers.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define EH_BULK_X86 1
+#endif
+
+// Month-end job: add interest to every balance and charge a fee.
+// Doing that with one BankAccount per customer means a deposit() and a withdraw() per account,
+// with a branch (and possibly a throw) for each. The kernel below works on a plain contiguous array of balances
+// and processes 4 (AVX2) or 8 (AVX-512) balances per instruction.
+//
+// For every balance:
+//     balance = balance * (1 + rate)         interest, like deposit()
+//     if (fee <= balance) balance -= fee      fee, like withdraw()
+//     else                record the index    "Insufficient funds": the balance keeps its interest, but no fee is taken
+//
+// Instead of branching, the SIMD versions compare all lanes at once and use the result as a mask:
+// the fee is only subtracted in the lanes where it fits, and the mask bits of the other lanes give the failed indices.
+// All versions do the same two operations in the same order, so they produce bit-identical balances.
+//
+// Invalid arguments are checked once for the whole array, not per account:
+// a negative fee throws InvalidAmountException, a rate of -100% or less throws std::invalid_argument.
+
+namespace bulk_detail {
+
+inline void applyScalar(double* balances, std::size_t begin, std::size_t end, double factor, double fee,
+                        std::vector<std::size_t>& failed) {
+    for (std::size_t i = begin; i < end; ++i) {
+        const double withInterest = balances[i] * factor;
+        if (fee <= withInterest) {
+            balances[i] = withInterest - fee;
+        } else {
+            balances[i] = withInterest;
+            failed.push_back(i);
+        }
+    }
+}
+
+#if defined(EH_BULK_X86)
+
+__attribute__((target("avx2"))) inline std::size_t applyAvx2(double* balances, std::size_t count, double factor,
+                                                              double fee, std::vector<std::size_t>& failed) {
+    const __m256d factors = _mm256_set1_pd(factor);
+    const __m256d fees = _mm256_set1_pd(fee);
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m256d withInterest = _mm256_mul_pd(_mm256_loadu_pd(balances + i), factors);
+        const __m256d fits = _mm256_cmp_pd(fees, withInterest, _CMP_LE_OQ);
+        // fee where it fits, 0.0 in the other lanes
+        const __m256d charged = _mm256_and_pd(fits, fees);
+        _mm256_storeu_pd(balances + i, _mm256_sub_pd(withInterest, charged));
+
+        unsigned insufficient = ~static_cast<unsigned>(_mm256_movemask_pd(fits)) & 0xFu;
+        while (insufficient != 0) {
+            failed.push_back(i + static_cast<std::size_t>(__builtin_ctz(insufficient)));
+            insufficient &= insufficient - 1;
+        }
+    }
+    return i;
+}
+
+__attribute__((target("avx512f"))) inline std::size_t applyAvx512(double* balances, std::size_t count, double factor,
+                                                                   double fee, std::vector<std::size_t>& failed) {
+    const __m512d factors = _mm512_set1_pd(factor);
+    const __m512d fees = _mm512_set1_pd(fee);
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m512d withInterest = _mm512_mul_pd(_mm512_loadu_pd(balances + i), factors);
+        const __mmask8 fits = _mm512_cmp_pd_mask(fees, withInterest, _CMP_LE_OQ);
+        // Masked subtract: lanes where the fee does not fit keep withInterest.
+        _mm512_storeu_pd(balances + i, _mm512_mask_sub_pd(withInterest, fits, withInterest, fees));
+
+        unsigned insufficient = ~static_cast<unsigned>(fits) & 0xFFu;
+        while (insufficient != 0) {
+            failed.push_back(i + static_cast<std::size_t>(__builtin_ctz(insufficient)));
+            insufficient &= insufficient - 1;
+        }
+    }
+    return i;
+}
+
+#endif
+
+} // namespace bulk_detail
+
+// Which instruction set applyInterestAndFee() uses.
+enum class BulkKernel {
+    Auto,    // the best one this CPU supports
+    Scalar,
+    Avx2,
+    Avx512,
+};
+
+// The kernel Auto resolves to on this CPU.
+inline BulkKernel bestBulkKernel() noexcept {
+#if defined(EH_BULK_X86)
+    if (__builtin_cpu_supports("avx512f")) {
+        return BulkKernel::Avx512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return BulkKernel::Avx2;
+    }
+#endif
+    return BulkKernel::Scalar;
+}
+
+// Apply interest and fee to balances[0 .. count). Indices of accounts that could not pay the fee are appended to failed.
+// A kernel this CPU does not support is replaced by bestBulkKernel(), so asking for AVX-512 on an AVX2 machine runs
+// AVX2 instead of stopping at an illegal instruction (SIGILL).
+inline void applyInterestAndFee(double* balances, std::size_t count, double rate, double fee,
+                                std::vector<std::size_t>& failed, BulkKernel kernel = BulkKernel::Auto) {
+    if (fee < 0.0) {
+        throw_invalid_amount("Invalid fee amount", fee);
+    }
+    if (!(rate > -1.0)) {
+        throw_invalid_argument("Invalid interest rate");
+    }
+    const double factor = 1.0 + rate;
+    const BulkKernel best = bestBulkKernel();
+    if (kernel == BulkKernel::Auto || static_cast<int>(kernel) > static_cast<int>(best)) {
+        kernel = best;
+    }
+
+    std::size_t done = 0;
+#if defined(EH_BULK_X86)
+    if (kernel == BulkKernel::Avx512) {
+        done = bulk_detail::applyAvx512(balances, count, factor, fee, failed);
+    } else if (kernel == BulkKernel::Avx2) {
+        done = bulk_detail::applyAvx2(balances, count, factor, fee, failed);
+    }
+#endif
+    // The scalar loop does the whole array, or the last few balances the vector loop left over.
+    bulk_detail::applyScalar(balances, done, count, factor, fee, failed);
+}
+
+// Same, returning the failed indices.
+inline std::vector<std::size_t> applyInterestAndFee(std::vector<double>& balances, double rate, double fee,
+                                                    BulkKernel kernel = BulkKernel::Auto) {
+    std::vector<std::size_t> failed;
+    applyInterestAndFee(balances.data(), balances.size(), rate, fee, failed, kernel);
+    return failed;
+}
+
+#endif //EXCEPTIONHANDLING_BULK_BALANCE_H
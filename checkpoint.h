@@ -0,0 +1,498 @@
+#ifndef EXCEPTIONHANDLING_CHECKPOINT_H
+#define EXCEPTIONHANDLING_CHECKPOINT_H
+
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "error_codes.h"
+#include "throw_helpers.h"
+
+// Balances with incremental checkpoints.
+//
+// A full snapshot writes every balance, however few of them changed since the last one. CheckpointedBalances keeps
+// the balances of accounts 0 .. size-1 in one array, split into blocks of kBlockBalances, and one dirty bit per block.
+// deposit() and withdraw() set the bit of the block they change (an OR into a bitmap small enough to stay in the
+// cache), and checkpoint() writes only the blocks whose bit is set, then clears the bits:
+//
+//     CheckpointedBalances balances("/var/lib/bank/checkpoints", 10'000'000);
+//     balances.deposit(42, 100.0);
+//     balances.checkpoint();                     // a delta with one block
+//     ...
+//     CheckpointedBalances restored = CheckpointedBalances::restore("/var/lib/bank/checkpoints");
+//
+// The directory holds a base (every balance) and the deltas written after it, numbered by checkpoint sequence.
+// Restore reads the base and applies the deltas in order. So that restore does not read an unbounded chain,
+// checkpoint() writes a new base instead of a delta ("compaction") when the deltas since the base would add up to
+// more bytes than the base itself, or when there are CheckpointOptions::maxDeltas of them, and then deletes the deltas.
+//
+// Sequence numbers only grow within a directory. A new CheckpointedBalances on a directory that holds checkpoints
+// already continues after the highest number in it, so its first checkpoint (a base) is newer than every file there:
+// restore never applies an old delta to it, even if a crash leaves the old deltas behind.
+//
+// Every file is written to a temporary name, flushed and renamed, so a crash leaves either the whole file or none,
+// and each carries a checksum. A delta holds the numbers of its blocks, then the blocks, written straight from
+// the balance array (writev); adjacent dirty blocks go out as one piece.
+//
+// The blocks are 64 balances (512 bytes), smaller than a memory page: updates to random accounts dirty a block
+// for every account they touch, and small blocks write less around each one. The bitmap has one bit per 512 bytes
+// of balances, 2.5 KB for a million accounts.
+//
+// The account rules are BankAccount's (same exceptions and AccountStatus values). Not thread-safe: checkpoint()
+// runs between operations, so each checkpoint is a consistent state. File errors are thrown as std::system_error
+// (std::filesystem::filesystem_error for directory operations), a damaged checkpoint file as std::runtime_error.
+
+struct CheckpointOptions {
+    std::size_t maxDeltas = 64;   // deltas after a base, before checkpoint() compacts anyway
+    bool sync = true;             // fdatasync every file before it is renamed into place
+};
+
+struct CheckpointResult {
+    std::uint64_t sequence = 0;
+    bool full = false;            // a base (compaction) rather than a delta
+    std::size_t blocks = 0;       // blocks written
+    std::size_t bytes = 0;        // size of the file
+};
+
+class CheckpointedBalances {
+public:
+    static constexpr std::size_t kBlockBalances = 64;
+
+    CheckpointedBalances(std::string directory, std::size_t accounts, double initialBalance = 0.0,
+                         CheckpointOptions options = {})
+        : directory_(std::move(directory)),
+          options_(options),
+          accounts_(accounts),
+          balances_(blockCount(accounts) * kBlockBalances, 0.0),
+          dirty_((blockCount(accounts) + 63) / 64, 0) {
+        std::fill(balances_.begin(), balances_.begin() + static_cast<std::ptrdiff_t>(accounts), initialBalance);
+        std::filesystem::create_directories(directory_);
+        sequence_ = lastSequenceIn(directory_);
+    }
+
+    // Rebuild the balances from the base and the deltas in directory.
+    static CheckpointedBalances restore(std::string directory, CheckpointOptions options = {}) {
+        const std::string basePath = directory + "/" + kBaseName;
+        File base = File::openForReading(basePath);
+        const Header header = base.readHeader(basePath, Kind::Base);
+        CheckpointedBalances balances(std::move(directory), header.accounts, 0.0, options);
+        if (header.blocks != blockCount(header.accounts)) {
+            throwCorrupt(basePath);
+        }
+        std::vector<iovec> pieces{{balances.balances_.data(), balances.balances_.size() * sizeof(double)}};
+        base.readAll(pieces, basePath);
+        if (checksum(balances.balances_.data(), balances.balances_.size(), kChecksumSeed) != header.checksum) {
+            throwCorrupt(basePath);
+        }
+        balances.sequence_ = header.sequence;
+        balances.baseBytes_ = baseFileBytes(header.accounts);
+        balances.hasBase_ = true;
+
+        // Deltas follow the base without gaps; the first missing number is the end.
+        for (;;) {
+            const std::string path = balances.deltaPath(balances.sequence_ + 1);
+            File delta = File::openForReading(path, true);
+            if (!delta.isOpen()) {
+                break;
+            }
+            const Header deltaHeader = delta.readHeader(path, Kind::Delta);
+            if (deltaHeader.accounts != header.accounts || deltaHeader.sequence != balances.sequence_ + 1 ||
+                deltaHeader.blocks > blockCount(header.accounts)) {
+                throwCorrupt(path);
+            }
+            std::vector<std::uint32_t> blocks(paddedIndexCount(deltaHeader.blocks));
+            std::vector<iovec> indexPiece{{blocks.data(), blocks.size() * sizeof(std::uint32_t)}};
+            delta.readAll(indexPiece, path);
+            blocks.resize(deltaHeader.blocks);
+            for (std::uint32_t block : blocks) {
+                if (block >= blockCount(header.accounts)) {
+                    throwCorrupt(path);
+                }
+            }
+            std::vector<iovec> blockPieces = balances.piecesOf(blocks);
+            delta.readAll(blockPieces, path);
+            if (balances.checksumOf(blocks) != deltaHeader.checksum) {
+                throwCorrupt(path);
+            }
+            balances.sequence_ = deltaHeader.sequence;
+            ++balances.deltas_;
+            balances.deltaBytes_ += fileBytes(deltaHeader.blocks);
+        }
+        return balances;
+    }
+
+    // The amount checks are written !(amount > 0.0) so they also reject NaN: a NaN balance would be written into
+    // every later checkpoint and come back on restore.
+    void deposit(std::size_t account, double amount) {
+        if (account >= accounts_) {
+            throw_unknown_account(account);
+        }
+        if (!(amount > 0.0)) {
+            throw_invalid_amount("Invalid deposit amount", amount);
+        }
+        balances_[account] += amount;
+        markDirty(account);
+    }
+
+    void withdraw(std::size_t account, double amount) {
+        if (account >= accounts_) {
+            throw_unknown_account(account);
+        }
+        if (!(amount > 0.0)) {
+            throw_invalid_amount("Invalid withdrawal amount", amount);
+        }
+        if (amount > balances_[account]) {
+            throw_insufficient_funds(amount, balances_[account]);
+        }
+        balances_[account] -= amount;
+        markDirty(account);
+    }
+
+    AccountStatus tryDeposit(std::size_t account, double amount) noexcept {
+        if (account >= accounts_) {
+            return AccountStatus::UnknownAccount;
+        }
+        if (!(amount > 0.0)) {
+            return AccountStatus::InvalidAmount;
+        }
+        balances_[account] += amount;
+        markDirty(account);
+        return AccountStatus::Ok;
+    }
+
+    AccountStatus tryWithdraw(std::size_t account, double amount) noexcept {
+        if (account >= accounts_) {
+            return AccountStatus::UnknownAccount;
+        }
+        if (!(amount > 0.0)) {
+            return AccountStatus::InvalidAmount;
+        }
+        if (amount > balances_[account]) {
+            return AccountStatus::InsufficientFunds;
+        }
+        balances_[account] -= amount;
+        markDirty(account);
+        return AccountStatus::Ok;
+    }
+
+    double getBalance(std::size_t account) const {
+        if (account >= accounts_) {
+            throw_unknown_account(account);
+        }
+        return balances_[account];
+    }
+
+    // Write the blocks changed since the last checkpoint, or a new base when compaction is due
+    // (the first checkpoint is always a base).
+    CheckpointResult checkpoint() {
+        const std::vector<std::uint32_t> blocks = dirtyBlockList();
+        const std::size_t bytes = fileBytes(blocks.size());
+        if (!hasBase_ || deltas_ >= options_.maxDeltas || deltaBytes_ + bytes > baseBytes_) {
+            return compact();
+        }
+        const std::uint64_t sequence = sequence_ + 1;
+        std::vector<std::uint32_t> index(paddedIndexCount(blocks.size()), 0);
+        std::copy(blocks.begin(), blocks.end(), index.begin());
+        std::vector<iovec> pieces{{nullptr, sizeof(Header)}, {index.data(), index.size() * sizeof(std::uint32_t)}};
+        const std::vector<iovec> blockPieces = piecesOf(blocks);
+        pieces.insert(pieces.end(), blockPieces.begin(), blockPieces.end());
+        const Header header{kMagic, Kind::Delta, sequence, accounts_, blocks.size(), checksumOf(blocks)};
+        pieces[0].iov_base = const_cast<Header*>(&header);
+        writeFile(deltaPath(sequence), pieces);
+
+        clearDirty();
+        sequence_ = sequence;
+        ++deltas_;
+        deltaBytes_ += bytes;
+        return {sequence, false, blocks.size(), bytes};
+    }
+
+    // Write every balance as the new base and delete the deltas it replaces.
+    CheckpointResult compact() {
+        const std::uint64_t sequence = sequence_ + 1;
+        const Header header{kMagic, Kind::Base, sequence, accounts_, blockCount(accounts_),
+                            checksum(balances_.data(), balances_.size(), kChecksumSeed)};
+        std::vector<iovec> pieces{{const_cast<Header*>(&header), sizeof(Header)},
+                                  {balances_.data(), balances_.size() * sizeof(double)}};
+        writeFile(directory_ + "/" + kBaseName, pieces);
+
+        // The new base is in place; every delta in the directory is older. Deleting them is only tidying up:
+        // after a crash in between, restore starts from the new base and ignores them.
+        for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(directory_)) {
+            if (entry.path().filename().string().rfind(kDeltaPrefix, 0) == 0) {
+                std::filesystem::remove(entry.path());
+            }
+        }
+        clearDirty();
+        sequence_ = sequence;
+        hasBase_ = true;
+        deltas_ = 0;
+        deltaBytes_ = 0;
+        baseBytes_ = baseFileBytes(accounts_);
+        return {sequence, true, blockCount(accounts_), baseBytes_};
+    }
+
+    std::size_t size() const noexcept { return accounts_; }
+    std::uint64_t sequence() const noexcept { return sequence_; }
+    std::size_t deltasSinceBase() const noexcept { return deltas_; }
+
+    std::size_t dirtyBlocks() const noexcept {
+        std::size_t count = 0;
+        for (std::uint64_t word : dirty_) {
+            count += static_cast<std::size_t>(std::popcount(word));
+        }
+        return count;
+    }
+
+    std::size_t blocks() const noexcept { return blockCount(accounts_); }
+
+private:
+    static constexpr std::uint32_t kMagic = 0x4b434845;   // "EHCK"
+    static constexpr std::uint64_t kChecksumSeed = 0xcbf29ce484222325ULL;
+    static constexpr const char* kBaseName = "base.checkpoint";
+    static constexpr const char* kDeltaPrefix = "delta-";
+
+    enum class Kind : std::uint32_t {
+        Base = 1,
+        Delta = 2,
+    };
+
+    // The file starts with the header; a delta continues with its block numbers (padded to 8 bytes) and blocks,
+    // a base with all blocks. The checksum covers the balances written, not the header or the block numbers,
+    // which restore checks against the header instead.
+    struct Header {
+        std::uint32_t magic;
+        Kind kind;
+        std::uint64_t sequence;
+        std::uint64_t accounts;
+        std::uint64_t blocks;
+        std::uint64_t checksum;
+    };
+
+    static_assert(sizeof(Header) == 40, "Header is the on-disk format");
+
+    // File descriptor that closes itself.
+    class File {
+    public:
+        explicit File(int fd) noexcept : fd_(fd) {}
+        File(File&& other) noexcept : fd_(std::exchange(other.fd_, -1)) {}
+        File& operator=(File&&) = delete;
+        ~File() {
+            if (fd_ >= 0) {
+                ::close(fd_);
+            }
+        }
+
+        // With missingIsOk, a file that does not exist gives a File that is not open instead of an exception.
+        static File openForReading(const std::string& path, bool missingIsOk = false) {
+            const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0 && !(missingIsOk && errno == ENOENT)) {
+                throw std::system_error(errno, std::generic_category(), path);
+            }
+            return File(fd);
+        }
+
+        bool isOpen() const noexcept { return fd_ >= 0; }
+        int fd() const noexcept { return fd_; }
+
+        Header readHeader(const std::string& path, Kind kind) {
+            Header header{};
+            std::vector<iovec> piece{{&header, sizeof header}};
+            readAll(piece, path);
+            if (header.magic != kMagic || header.kind != kind) {
+                throwCorrupt(path);
+            }
+            return header;
+        }
+
+        // readv()/writev() until every piece is done; pieces is used up on the way.
+        void readAll(std::vector<iovec>& pieces, const std::string& path) {
+            transfer(pieces, path, false);
+        }
+
+        void writeAll(std::vector<iovec>& pieces, const std::string& path) {
+            transfer(pieces, path, true);
+        }
+
+    private:
+        void transfer(std::vector<iovec>& pieces, const std::string& path, bool write) {
+            std::size_t first = 0;
+            while (first < pieces.size()) {
+                const int count = static_cast<int>(std::min<std::size_t>(pieces.size() - first, IOV_MAX));
+                const ssize_t done = write ? ::writev(fd_, &pieces[first], count) : ::readv(fd_, &pieces[first], count);
+                if (done < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    throw std::system_error(errno, std::generic_category(), path);
+                }
+                if (done == 0) {
+                    throwCorrupt(path);   // read: the file is shorter than its header says
+                }
+                // Skip the pieces that are complete and move into the one that is not.
+                auto left = static_cast<std::size_t>(done);
+                while (first < pieces.size() && left >= pieces[first].iov_len) {
+                    left -= pieces[first].iov_len;
+                    ++first;
+                }
+                if (left > 0) {
+                    pieces[first].iov_base = static_cast<char*>(pieces[first].iov_base) + left;
+                    pieces[first].iov_len -= left;
+                }
+            }
+        }
+
+        int fd_;
+    };
+
+    [[noreturn]] static void throwCorrupt(const std::string& path) {
+        throw std::runtime_error("Damaged checkpoint file: " + path);
+    }
+
+    static std::size_t blockCount(std::size_t accounts) noexcept {
+        return (accounts + kBlockBalances - 1) / kBlockBalances;
+    }
+
+    // Block numbers are 4 bytes; an odd count is padded so the blocks start 8-byte aligned.
+    static std::size_t paddedIndexCount(std::size_t blocks) noexcept {
+        return (blocks + 1) & ~std::size_t{1};
+    }
+
+    static std::size_t fileBytes(std::size_t blocks) noexcept {
+        return sizeof(Header) + paddedIndexCount(blocks) * sizeof(std::uint32_t) +
+               blocks * kBlockBalances * sizeof(double);
+    }
+
+    static std::size_t baseFileBytes(std::size_t accounts) noexcept {
+        return sizeof(Header) + blockCount(accounts) * kBlockBalances * sizeof(double);
+    }
+
+    // FNV-1a over 8-byte words instead of bytes: one multiply per balance.
+    static std::uint64_t checksum(const double* balances, std::size_t count, std::uint64_t hash) noexcept {
+        for (std::size_t i = 0; i < count; ++i) {
+            hash = (hash ^ std::bit_cast<std::uint64_t>(balances[i])) * 0x100000001b3ULL;
+        }
+        return hash;
+    }
+
+    std::uint64_t checksumOf(const std::vector<std::uint32_t>& blocks) const noexcept {
+        std::uint64_t hash = kChecksumSeed;
+        for (std::uint32_t block : blocks) {
+            hash = checksum(&balances_[block * kBlockBalances], kBlockBalances, hash);
+        }
+        return hash;
+    }
+
+    void markDirty(std::size_t account) noexcept {
+        const std::size_t block = account / kBlockBalances;
+        dirty_[block / 64] |= std::uint64_t{1} << (block % 64);
+    }
+
+    void clearDirty() noexcept {
+        std::fill(dirty_.begin(), dirty_.end(), 0);
+    }
+
+    // Dirty blocks in ascending order: whole clean words are skipped, set bits are found with countr_zero.
+    std::vector<std::uint32_t> dirtyBlockList() const {
+        std::vector<std::uint32_t> blocks;
+        blocks.reserve(dirtyBlocks());
+        for (std::size_t word = 0; word < dirty_.size(); ++word) {
+            for (std::uint64_t bits = dirty_[word]; bits != 0; bits &= bits - 1) {
+                blocks.push_back(static_cast<std::uint32_t>(word * 64 + static_cast<std::size_t>(std::countr_zero(bits))));
+            }
+        }
+        return blocks;
+    }
+
+    // The balances of the blocks as I/O pieces, one per run of adjacent blocks.
+    std::vector<iovec> piecesOf(const std::vector<std::uint32_t>& blocks) {
+        std::vector<iovec> pieces;
+        constexpr std::size_t kBlockBytes = kBlockBalances * sizeof(double);
+        for (std::size_t i = 0; i < blocks.size(); ++i) {
+            if (i > 0 && blocks[i] == blocks[i - 1] + 1) {
+                pieces.back().iov_len += kBlockBytes;
+            } else {
+                pieces.push_back({&balances_[blocks[i] * kBlockBalances], kBlockBytes});
+            }
+        }
+        return pieces;
+    }
+
+    // Highest sequence number of the base and the deltas in directory, 0 if there are none.
+    static std::uint64_t lastSequenceIn(const std::string& directory) {
+        std::uint64_t last = 0;
+        const std::string basePath = directory + "/" + kBaseName;
+        File base = File::openForReading(basePath, true);
+        if (base.isOpen()) {
+            last = base.readHeader(basePath, Kind::Base).sequence;
+        }
+        for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(directory)) {
+            const std::string name = entry.path().filename().string();
+            if (name.rfind(kDeltaPrefix, 0) == 0) {
+                const std::uint64_t sequence = std::strtoull(name.c_str() + std::strlen(kDeltaPrefix), nullptr, 10);
+                last = std::max(last, sequence);
+            }
+        }
+        return last;
+    }
+
+    std::string deltaPath(std::uint64_t sequence) const {
+        char name[40];
+        std::snprintf(name, sizeof name, "%s%020llu.checkpoint", kDeltaPrefix,
+                      static_cast<unsigned long long>(sequence));
+        return directory_ + "/" + name;
+    }
+
+    // Write to a temporary file, flush it, and rename it to path: path has either the old or the whole new file.
+    void writeFile(const std::string& path, std::vector<iovec>& pieces) {
+        const std::string temporary = path + ".tmp";
+        {
+            const int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            if (fd < 0) {
+                throw std::system_error(errno, std::generic_category(), temporary);
+            }
+            File file(fd);
+            file.writeAll(pieces, temporary);
+            if (options_.sync && ::fdatasync(file.fd()) != 0) {
+                throw std::system_error(errno, std::generic_category(), temporary);
+            }
+        }
+        std::filesystem::rename(temporary, path);
+        if (options_.sync) {
+            // The rename itself is durable once the directory is flushed.
+            File directory = File::openForReading(directory_);
+            if (::fsync(directory.fd()) != 0) {
+                throw std::system_error(errno, std::generic_category(), directory_);
+            }
+        }
+    }
+
+    std::string directory_;
+    CheckpointOptions options_;
+    std::size_t accounts_;
+    std::vector<double> balances_;       // whole blocks; the balances after the last account stay 0
+    std::vector<std::uint64_t> dirty_;   // one bit per block
+    std::uint64_t sequence_ = 0;         // of the last checkpoint written or restored
+    bool hasBase_ = false;
+    std::size_t deltas_ = 0;             // since the base
+    std::size_t deltaBytes_ = 0;         // their total size
+    std::size_t baseBytes_ = 0;
+};
+
+#endif //EXCEPTIONHANDLING_CHECKPOINT_H
@@ -0,0 +1,264 @@
+#ifndef EXCEPTIONHANDLING_CIRCUIT_BREAKER_H
+#define EXCEPTIONHANDLING_CIRCUIT_BREAKER_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+
+#include "bank_account.h"
+
+// Circuit breaker: when most recent calls fail (a dependency is unhealthy), every further call would still
+// validate, throw and unwind, only to fail again. The breaker watches the failure ratio of recent calls and,
+// above a threshold, "opens": calls are rejected immediately with a status, no exception is thrown.
+// After a while it lets a few probe calls through ("half-open"). If they succeed it closes again,
+// if one fails it opens again.
+//
+//   Closed --(failure ratio too high)--> Open --(openDuration passed)--> HalfOpen --(probes succeed)--> Closed
+//                                          ^------------------(a probe fails)-----------------------------'
+
+enum class BreakerState : std::uint32_t {
+    Closed,
+    Open,
+    HalfOpen,
+};
+
+struct CircuitBreakerConfig {
+    std::chrono::milliseconds window{10000};      // how far back the failure ratio looks
+    std::uint32_t buckets = 10;                   // window is split into this many buckets (at most 16)
+    double failureRatio = 0.5;                    // open when at least this fraction of calls failed...
+    std::uint32_t minimumCalls = 20;              // ...and the window holds at least this many calls
+    std::chrono::milliseconds openDuration{5000}; // how long to reject before probing
+    std::uint32_t halfOpenProbes = 3;             // successful probes needed to close again
+};
+
+// What CircuitBreaker::allow() decided. A probe holds one of the probe slots of a half-open round;
+// pass the permit to onRejected() so that slot is given back.
+struct BreakerPermit {
+    bool allowed = false;
+    bool probe = false;
+    std::uint32_t round = 0;   // half-open round the probe slot belongs to
+
+    explicit operator bool() const noexcept { return allowed; }
+};
+
+class CircuitBreaker {
+public:
+    explicit CircuitBreaker(CircuitBreakerConfig config = {})
+        : config_(config),
+          bucketCount_(config.buckets == 0 ? 1 : (config.buckets > kMaxBuckets ? kMaxBuckets : config.buckets)),
+          bucketNs_(std::chrono::duration_cast<std::chrono::nanoseconds>(config.window).count() / bucketCount_),
+          openNs_(std::chrono::duration_cast<std::chrono::nanoseconds>(config.openDuration).count()) {
+        if (bucketNs_ <= 0) {
+            bucketNs_ = 1;
+        }
+    }
+
+    // Should the call go ahead? A permit that converts to false means: rejected, do not call.
+    BreakerPermit allow() noexcept {
+        switch (state_.load(std::memory_order_acquire)) {
+        case BreakerState::Closed:
+            return {true, false, 0};
+        case BreakerState::Open: {
+            if (nowNs() < openUntilNs_.load(std::memory_order_acquire)) {
+                return {};
+            }
+            BreakerState expected = BreakerState::Open;
+            if (state_.compare_exchange_strong(expected, BreakerState::HalfOpen, std::memory_order_acq_rel)) {
+                // A new round with no probe slots taken; slots of the last round can no longer be given back.
+                const std::uint64_t round = roundOf(probes_.load(std::memory_order_relaxed)) + 1;
+                probes_.store(round << 32, std::memory_order_relaxed);
+                probesSucceeded_.store(0, std::memory_order_relaxed);
+            }
+            return allow();
+        }
+        case BreakerState::HalfOpen: {
+            // Take a slot only while there is one: a caller that is turned away leaves the count alone.
+            std::uint64_t word = probes_.load(std::memory_order_relaxed);
+            while (startedOf(word) < config_.halfOpenProbes) {
+                if (probes_.compare_exchange_weak(word, word + 1, std::memory_order_relaxed)) {
+                    return {true, true, static_cast<std::uint32_t>(roundOf(word))};
+                }
+            }
+            return {};
+        }
+        }
+        return {true, false, 0};
+    }
+
+    void onSuccess() noexcept {
+        record(false);
+        if (state_.load(std::memory_order_acquire) == BreakerState::HalfOpen &&
+            probesSucceeded_.fetch_add(1, std::memory_order_relaxed) + 1 >= config_.halfOpenProbes) {
+            BreakerState expected = BreakerState::HalfOpen;
+            if (state_.compare_exchange_strong(expected, BreakerState::Closed, std::memory_order_acq_rel)) {
+                // Start the closed state with a clean window, the failures that opened us are history.
+                for (auto& bucket : buckets_) {
+                    bucket.store(0, std::memory_order_relaxed);
+                }
+            }
+        }
+    }
+
+    void onFailure() noexcept {
+        record(true);
+        const BreakerState state = state_.load(std::memory_order_acquire);
+        if (state == BreakerState::HalfOpen) {
+            trip(BreakerState::HalfOpen);
+        } else if (state == BreakerState::Closed && failureRatioExceeded()) {
+            trip(BreakerState::Closed);
+        }
+    }
+
+    // The call was allowed but refused its input (an invalid amount, say): says nothing about the dependency,
+    // so it counts neither way. If the permit took a probe slot, and its half-open round is still the current
+    // one, the slot is given back.
+    void onRejected(const BreakerPermit& permit) noexcept {
+        if (!permit.probe) {
+            return;
+        }
+        std::uint64_t word = probes_.load(std::memory_order_relaxed);
+        while (roundOf(word) == permit.round && startedOf(word) != 0) {
+            if (probes_.compare_exchange_weak(word, word - 1, std::memory_order_relaxed)) {
+                return;
+            }
+        }
+    }
+
+    BreakerState state() const noexcept {
+        return state_.load(std::memory_order_acquire);
+    }
+
+private:
+    static constexpr std::uint32_t kMaxBuckets = 16;
+
+    // A bucket is one 64-bit word, so it can be updated with one CAS:
+    // bits 48..63 time slot number (to detect a stale bucket), 24..47 failures, 0..23 successes.
+    static constexpr std::uint64_t kCountMask = (std::uint64_t{1} << 24) - 1;
+
+    static std::int64_t nowNs() noexcept {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    static std::uint64_t slotOf(std::uint64_t word) noexcept { return word >> 48; }
+    static std::uint64_t roundOf(std::uint64_t probes) noexcept { return probes >> 32; }
+    static std::uint64_t startedOf(std::uint64_t probes) noexcept { return probes & 0xFFFFFFFF; }
+    static std::uint64_t failuresOf(std::uint64_t word) noexcept { return (word >> 24) & kCountMask; }
+    static std::uint64_t successesOf(std::uint64_t word) noexcept { return word & kCountMask; }
+
+    void record(bool failure) noexcept {
+        const auto slot = static_cast<std::uint64_t>(nowNs() / bucketNs_) & 0xFFFF;
+        std::atomic<std::uint64_t>& bucket = buckets_[slot % bucketCount_];
+        std::uint64_t word = bucket.load(std::memory_order_relaxed);
+        for (;;) {
+            // A bucket from an older round of the ring starts over at zero.
+            std::uint64_t failures = slotOf(word) == slot ? failuresOf(word) : 0;
+            std::uint64_t successes = slotOf(word) == slot ? successesOf(word) : 0;
+            if (failure) {
+                failures += failures < kCountMask ? 1 : 0;
+            } else {
+                successes += successes < kCountMask ? 1 : 0;
+            }
+            const std::uint64_t updated = (slot << 48) | (failures << 24) | successes;
+            if (bucket.compare_exchange_weak(word, updated, std::memory_order_relaxed)) {
+                return;
+            }
+        }
+    }
+
+    bool failureRatioExceeded() const noexcept {
+        const auto current = static_cast<std::uint64_t>(nowNs() / bucketNs_) & 0xFFFF;
+        std::uint64_t failures = 0;
+        std::uint64_t total = 0;
+        for (std::uint32_t i = 0; i < bucketCount_; ++i) {
+            const std::uint64_t word = buckets_[i].load(std::memory_order_relaxed);
+            // Only buckets of the last bucketCount_ slots belong to the window.
+            if (((current - slotOf(word)) & 0xFFFF) >= bucketCount_) {
+                continue;
+            }
+            failures += failuresOf(word);
+            total += failuresOf(word) + successesOf(word);
+        }
+        return total >= config_.minimumCalls &&
+               static_cast<double>(failures) >= config_.failureRatio * static_cast<double>(total);
+    }
+
+    void trip(BreakerState from) noexcept {
+        openUntilNs_.store(nowNs() + openNs_, std::memory_order_release);
+        state_.compare_exchange_strong(from, BreakerState::Open, std::memory_order_acq_rel);
+    }
+
+    CircuitBreakerConfig config_;
+    std::uint32_t bucketCount_;
+    std::int64_t bucketNs_;
+    std::int64_t openNs_;
+    std::atomic<BreakerState> state_{BreakerState::Closed};
+    std::atomic<std::int64_t> openUntilNs_{0};
+    std::atomic<std::uint64_t> probes_{0};   // bits 32..63 half-open round, 0..31 probe slots taken in it
+    std::atomic<std::uint32_t> probesSucceeded_{0};
+    std::array<std::atomic<std::uint64_t>, kMaxBuckets> buckets_{};
+};
+
+// BankAccount operations behind a circuit breaker.
+// While the breaker is closed, deposit()/withdraw() behave exactly like BankAccount: they return Ok or throw.
+// Every exception counts as a failure, except an invalid amount (std::invalid_argument), which is bad input.
+// While it is open they return AccountStatus::CircuitOpen at once, without validating or throwing.
+//
+// The breaker can belong to this account alone (per-account scope), or one breaker can be shared by
+// many accounts (global scope), e.g. all accounts that depend on the same backend.
+class BreakerAccount {
+public:
+    // Per-account scope: the account gets its own breaker.
+    explicit BreakerAccount(BankAccount& account, CircuitBreakerConfig config = {})
+        : account_(account), owned_(std::make_unique<CircuitBreaker>(config)), breaker_(*owned_) {}
+
+    // Global scope: the breaker is shared with other accounts.
+    BreakerAccount(BankAccount& account, CircuitBreaker& sharedBreaker)
+        : account_(account), breaker_(sharedBreaker) {}
+
+    AccountStatus deposit(double amount) {
+        return guarded([&] { account_.deposit(amount); });
+    }
+
+    AccountStatus withdraw(double amount) {
+        return guarded([&] { account_.withdraw(amount); });
+    }
+
+    double getBalance() const {
+        return account_.getBalance();
+    }
+
+    const CircuitBreaker& breaker() const noexcept {
+        return breaker_;
+    }
+
+private:
+    template <typename Operation>
+    AccountStatus guarded(Operation operation) {
+        const BreakerPermit permit = breaker_.allow();
+        if (!permit) {
+            return AccountStatus::CircuitOpen;
+        }
+        try {
+            operation();
+        } catch (const std::invalid_argument&) {
+            // InvalidAmountException: the caller's mistake, not a failure of the account.
+            breaker_.onRejected(permit);
+            throw;
+        } catch (...) {
+            breaker_.onFailure();
+            throw;
+        }
+        breaker_.onSuccess();
+        return AccountStatus::Ok;
+    }
+
+    BankAccount& account_;
+    std::unique_ptr<CircuitBreaker> owned_;
+    CircuitBreaker& breaker_;
+};
+
+#endif //EXCEPTIONHANDLING_CIRCUIT_BREAKER_H
@@ -0,0 +1,52 @@
+#ifndef EXCEPTIONHANDLING_CONTRACTS_H
+#define EXCEPTIONHANDLING_CONTRACTS_H
+
+#include "throw_helpers.h"
+
+// Precondition and invariant checks that can be configured for the whole build.
+//
+// EH_CHECK_LEVEL (set from CMake with -DEXCEPTION_HANDLING_CHECK_LEVEL=off|fast|audit):
+//   0  off    Preconditions are not checked. The compiler is told they hold (an assumption), so it can drop
+//             code that only matters when they do not. Only for trusted callers, such as internal batch jobs
+//             that validated their input already: a violated precondition is undefined behavior.
+//   1  fast   Preconditions are checked and throw the usual exceptions. This is the default and the behavior
+//             the examples in main() show.
+//   2  audit  Additionally checks invariants after every operation, e.g. that a withdrawal never takes a balance
+//             below what the account kind allows.
+//             Those checks are for tests and debugging; a violation throws ContractViolationException, a
+//             std::logic_error (which ends in std::terminate when it happens in a noexcept function such as
+//             tryWithdraw()).
+//
+// EH_EXPECTS(condition, onFailure)  precondition; onFailure is the statement that reports it (a throw helper call)
+// EH_AUDIT(condition, message)      invariant, only evaluated at audit level
+//
+// Domain rules are not contracts: "Insufficient funds" is checked at every level, and the try* functions
+// always return their AccountStatus.
+
+#ifndef EH_CHECK_LEVEL
+#define EH_CHECK_LEVEL 1
+#endif
+
+#if defined(__clang__)
+#define EH_ASSUME(condition) __builtin_assume(condition)
+#elif defined(__GNUC__)
+#define EH_ASSUME(condition) do { if (!(condition)) __builtin_unreachable(); } while (false)
+#elif defined(_MSC_VER)
+#define EH_ASSUME(condition) __assume(condition)
+#else
+#define EH_ASSUME(condition) do { } while (false)
+#endif
+
+#if EH_CHECK_LEVEL >= 1
+#define EH_EXPECTS(condition, onFailure) do { if (!(condition)) { onFailure; } } while (false)
+#else
+#define EH_EXPECTS(condition, onFailure) EH_ASSUME(condition)
+#endif
+
+#if EH_CHECK_LEVEL >= 2
+#define EH_AUDIT(condition, message) do { if (!(condition)) { throw_contract_violation(message); } } while (false)
+#else
+#define EH_AUDIT(condition, message) do { } while (false)
+#endif
+
+#endif //EXCEPTIONHANDLING_CONTRACTS_H
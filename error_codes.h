@@ -0,0 +1,123 @@
+#ifndef EXCEPTIONHANDLING_ERROR_CODES_H
+#define EXCEPTIONHANDLING_ERROR_CODES_H
+
+#include <string>
+#include <system_error>
+#include <type_traits>
+
+// Error codes for all project errors, in the std::error_code framework.
+//
+// Two enums, each with its own std::error_category:
+//   AccountStatus    "account"     result of the non-throwing account operations, and code() of the account exceptions
+//   ArithmeticError  "arithmetic"  result of try_calculate_avg() (average.h), and code() of DivideByZeroException
+//                                  and NegativeValueException
+// The exceptions in exceptions.h derive from CodedError as well, so one catch (const CodedError& e) sees the code of
+// any of them. InvalidArgumentException and ContractViolationException, which no non-throwing operation returns,
+// use std::errc values in std::generic_category() instead.
+// Both enums convert to std::error_code implicitly, and 0 (Ok) means "no error" as usual:
+//
+//     std::error_code error = account.tryWithdraw(50.0);
+//     if (error == AccountStatus::InsufficientFunds) { ... }
+//     ...
+//     catch (const CodedError& e) { if (e.code() == error) { ... } }
+//
+// Comparing two codes compares a category pointer and an int, instead of strings returned by what().
+
+// Result of the non-throwing account operations.
+// The throwing deposit()/withdraw() report the same situations as exceptions:
+// InvalidAmount as InvalidAmountException (a std::invalid_argument),
+// InsufficientFunds as InsufficientFundsException (a std::runtime_error)
+// LimitExceeded as WithdrawalLimitException and VelocityExceeded as VelocityLimitException (std::runtime_errors).
+enum class AccountStatus {
+    Ok,
+    InvalidAmount,
+    InsufficientFunds,
+    CircuitOpen,       // rejected by a circuit breaker without calling the account (circuit_breaker.h)
+    UnknownAccount,    // no account with this id (account_registry.h)
+    LimitExceeded,     // over a withdrawal limit of the account kind (account_policies.h)
+    VelocityExceeded,  // too many withdrawals, or too much, in the recent window (VelocityLimit, account_policies.h)
+};
+
+// Result of the non-throwing arithmetic functions.
+enum class ArithmeticError {
+    Ok,
+    DivideByZero,
+    NegativeValue,
+};
+
+template <>
+struct std::is_error_code_enum<AccountStatus> : std::true_type {};
+
+template <>
+struct std::is_error_code_enum<ArithmeticError> : std::true_type {};
+
+class AccountCategory final : public std::error_category {
+public:
+    const char* name() const noexcept override {
+        return "account";
+    }
+
+    std::string message(int value) const override {
+        switch (static_cast<AccountStatus>(value)) {
+            case AccountStatus::Ok: return "Success";
+            case AccountStatus::InvalidAmount: return "Invalid amount";
+            case AccountStatus::InsufficientFunds: return "Insufficient funds";
+            case AccountStatus::CircuitOpen: return "Circuit open";
+            case AccountStatus::UnknownAccount: return "Unknown account";
+            case AccountStatus::LimitExceeded: return "Withdrawal limit exceeded";
+            case AccountStatus::VelocityExceeded: return "Withdrawal velocity limit exceeded";
+        }
+        return "Unknown account error";
+    }
+};
+
+class ArithmeticCategory final : public std::error_category {
+public:
+    const char* name() const noexcept override {
+        return "arithmetic";
+    }
+
+    std::string message(int value) const override {
+        switch (static_cast<ArithmeticError>(value)) {
+            case ArithmeticError::Ok: return "Success";
+            case ArithmeticError::DivideByZero: return "Division by zero";
+            case ArithmeticError::NegativeValue: return "Negative value";
+        }
+        return "Unknown arithmetic error";
+    }
+};
+
+// One instance per category: error codes compare categories by address.
+inline const std::error_category& account_category() noexcept {
+    static const AccountCategory category;
+    return category;
+}
+
+inline const std::error_category& arithmetic_category() noexcept {
+    static const ArithmeticCategory category;
+    return category;
+}
+
+// Found by argument-dependent lookup when an enum value is converted to std::error_code.
+inline std::error_code make_error_code(AccountStatus status) noexcept {
+    return {static_cast<int>(status), account_category()};
+}
+
+inline std::error_code make_error_code(ArithmeticError error) noexcept {
+    return {static_cast<int>(error), arithmetic_category()};
+}
+
+// Base of every project exception that has an error code (exceptions.h).
+// It is not a std::exception itself, the exceptions derive from one of those as well.
+class CodedError {
+public:
+    virtual std::error_code code() const noexcept = 0;
+
+protected:
+    CodedError() = default;
+    CodedError(const CodedError&) = default;
+    CodedError& operator=(const CodedError&) = default;
+    ~CodedError() = default;
+};
+
+#endif //EXCEPTIONHANDLING_ERROR_CODES_H
@@ -0,0 +1,130 @@
+#ifndef EXCEPTIONHANDLING_ERROR_CONTEXT_H
+#define EXCEPTIONHANDLING_ERROR_CONTEXT_H
+
+#include <cstddef>
+#include <exception>
+#include <ostream>
+#include <utility>
+
+// "While doing X" context for an exception on its way up the call stack.
+//
+// In main.cpp secondLevel() and firstLevel() can either handle the exception from thirdLevel() or let it pass,
+// and the handler in main() only learns *what* failed, not what the program was doing at the time.
+// std::throw_with_nested() solves that by wrapping the exception in a new one at every level,
+// which allocates a new exception object per level and needs rethrow_if_nested() loops to read it back.
+//
+// Here every level adds a frame to a small fixed-size chain that belongs to the exception in flight instead:
+//
+//     void secondLevel() {
+//         with_error_context("while running secondLevel()", [] { thirdLevel(); });
+//     }
+//     ...
+//     catch (const std::exception& e) {
+//         print_error_context(std::cout, e);   // the message, then one "  while ..." line per level
+//     }
+//
+// with_error_context() catches, adds the frame and rethrows the same exception object (no copy, no allocation).
+// add_error_context() does the same from inside an existing catch block.
+//
+// The chain is thread_local and remembers which exception it belongs to (a std::exception_ptr). Adding a frame for
+// a different exception starts a new chain, so frames of an earlier, already handled exception never show up.
+// That std::exception_ptr keeps the exception object alive, so the handler that ends the chain releases it:
+// print_error_context() does, and a handler that only reads current_error_context() calls clear_error_context().
+// Frames are pointers to strings that must outlive the exception, in practice string literals.
+// At most kMaxErrorContextFrames are kept (the innermost ones); further frames are only counted.
+
+inline constexpr std::size_t kMaxErrorContextFrames = 16;
+
+class ErrorContextChain {
+public:
+    std::size_t size() const noexcept { return size_; }
+    bool empty() const noexcept { return size_ == 0; }
+    // Frames in the order they were added: innermost first.
+    const char* operator[](std::size_t index) const noexcept { return frames_[index]; }
+    const char* const* begin() const noexcept { return frames_; }
+    const char* const* end() const noexcept { return frames_ + size_; }
+    // Frames that did not fit.
+    std::size_t dropped() const noexcept { return dropped_; }
+
+private:
+    friend void add_error_context(const char* frame) noexcept;
+    friend const ErrorContextChain& current_error_context() noexcept;
+    friend void clear_error_context() noexcept;
+
+    static ErrorContextChain& forThisThread() noexcept {
+        thread_local ErrorContextChain chain;
+        return chain;
+    }
+
+    // The chain of the exception that is being handled right now; starts a new one for a new exception.
+    static ErrorContextChain& forCurrentException() noexcept {
+        ErrorContextChain& chain = forThisThread();
+        std::exception_ptr current = std::current_exception();
+        if (current != chain.owner_) {
+            chain.owner_ = std::move(current);
+            chain.size_ = 0;
+            chain.dropped_ = 0;
+        }
+        return chain;
+    }
+
+    std::exception_ptr owner_;
+    const char* frames_[kMaxErrorContextFrames] = {};
+    std::size_t size_ = 0;
+    std::size_t dropped_ = 0;
+};
+
+// Add a frame to the exception that is being handled. Only useful inside a catch block (followed by throw;).
+inline void add_error_context(const char* frame) noexcept {
+    ErrorContextChain& chain = ErrorContextChain::forCurrentException();
+    if (chain.size_ < kMaxErrorContextFrames) {
+        chain.frames_[chain.size_++] = frame;
+    } else {
+        ++chain.dropped_;
+    }
+}
+
+// The frames of the exception that is being handled, empty outside a catch block or if nobody added any.
+inline const ErrorContextChain& current_error_context() noexcept {
+    static const ErrorContextChain empty;
+    const ErrorContextChain& chain = ErrorContextChain::forThisThread();
+    if (!chain.owner_ || chain.owner_ != std::current_exception()) {
+        return empty;
+    }
+    return chain;
+}
+
+// Forget the frames and release the exception they belong to. Call it in the handler that ends the chain,
+// once the frames have been read; afterwards current_error_context() is empty.
+inline void clear_error_context() noexcept {
+    ErrorContextChain& chain = ErrorContextChain::forThisThread();
+    chain.owner_ = nullptr;
+    chain.size_ = 0;
+    chain.dropped_ = 0;
+}
+
+// Call f(); if it throws, add the frame and let the same exception continue.
+template <typename F>
+decltype(auto) with_error_context(const char* frame, F&& f) {
+    try {
+        return std::forward<F>(f)();
+    } catch (...) {
+        add_error_context(frame);
+        throw;
+    }
+}
+
+// Print e.what() followed by the context frames, then clear them. Call it in the catch block that handles e.
+inline void print_error_context(std::ostream& out, const std::exception& e) {
+    out << e.what() << '\n';
+    const ErrorContextChain& chain = current_error_context();
+    for (const char* frame : chain) {
+        out << "  " << frame << '\n';
+    }
+    if (chain.dropped() != 0) {
+        out << "  (" << chain.dropped() << " more)\n";
+    }
+    clear_error_context();
+}
+
+#endif //EXCEPTIONHANDLING_ERROR_CONTEXT_H
@@ -0,0 +1,201 @@
+#ifndef EXCEPTIONHANDLING_EXCEPTION_HANDLERS_H
+#define EXCEPTIONHANDLING_EXCEPTION_HANDLERS_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <type_traits>
+#include <typeindex>
+#include <typeinfo>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Central exception handlers instead of the same catch ladder in every function.
+//
+// main() catches MyException, DivideByZeroException, ..., std::exception and ... one after the other,
+// and every service handler would repeat that ladder. ExceptionHandlerRegistry holds one handler per exception type:
+//
+//     ExceptionHandlerRegistry handlers;
+//     handlers.on<InsufficientFundsException>([](const InsufficientFundsException& e) { ... });
+//     handlers.on<std::runtime_error>([](const std::runtime_error& e) { ... });
+//     handlers.onUnknown([] { ... });
+//     ...
+//     try { ... } catch (...) { handlers.dispatch(std::current_exception()); }
+//     // or, without the rethrow that reading an exception_ptr needs:
+//     try { ... } catch (const std::exception& e) { handlers.dispatch(e); } catch (...) { handlers.dispatchUnknown(); }
+//
+// Like a catch ladder, the handler of the most derived registered type wins: an InsufficientFundsException goes to
+// the InsufficientFundsException handler if there is one, otherwise to the std::runtime_error handler, and so on.
+// Finding that handler compares the exception against every registration, so the result is cached per dynamic type
+// (std::type_index). After the first exception of a type, dispatch is one table lookup by the address of its
+// std::type_info, whatever the number of handlers.
+//
+// Register all handlers first (not thread-safe), then dispatch from any number of threads.
+// Handler types must derive from std::exception; other exceptions, and those that match no registered type,
+// go to the onUnknown() handler.
+// With multiple inheritance two registered types can both match without one deriving from the other;
+// then the one registered first wins.
+
+class ExceptionHandlerRegistry {
+public:
+    template <typename E, typename F>
+    void on(F handler) {
+        static_assert(std::is_base_of_v<std::exception, E>, "handlers are registered for std::exception types");
+        Registration registration;
+        registration.type = &typeid(E);
+        registration.matches = [](const std::exception& e) {
+            // Every exception is a std::exception; a dynamic_cast to it would only compare &e with null.
+            if constexpr (std::is_same_v<E, std::exception>) {
+                (void)e;
+                return true;
+            } else {
+                return dynamic_cast<const E*>(&e) != nullptr;
+            }
+        };
+        registration.throwPointer = [] { throw static_cast<const E*>(nullptr); };
+        registration.catchesPointer = [](void (*thrower)()) {
+            try {
+                thrower();
+            } catch (const E*) {
+                return true;
+            } catch (...) {
+            }
+            return false;
+        };
+        registration.handler = [handler = std::move(handler)](const std::exception& e) { handler(downcast<E>(e)); };
+
+        const auto existing = byType_.find(std::type_index(typeid(E)));
+        if (existing != byType_.end()) {
+            registrations_[existing->second] = std::move(registration);
+        } else {
+            byType_.emplace(std::type_index(typeid(E)), registrations_.size());
+            registrations_.push_back(std::move(registration));
+        }
+        clearCache();
+    }
+
+    template <typename F>
+    void onUnknown(F handler) {
+        unknown_ = std::move(handler);
+    }
+
+    // Call the handler for a caught exception, or the onUnknown() handler if no registered type matches,
+    // like the catch (...) at the end of a ladder. Returns false if there is neither.
+    bool dispatch(const std::exception& e) const {
+        const std::size_t index = resolve(typeid(e), e);
+        if (index == kNoHandler) {
+            return dispatchUnknown();
+        }
+        registrations_[index].handler(e);
+        return true;
+    }
+
+    bool dispatchUnknown() const {
+        if (!unknown_) {
+            return false;
+        }
+        unknown_();
+        return true;
+    }
+
+    // Same for an exception_ptr. The exception object is only reachable by rethrowing it, which costs about
+    // as much as the original throw; inside a catch (const std::exception& e) block, prefer dispatch(e).
+    bool dispatch(const std::exception_ptr& exception) const {
+        try {
+            std::rethrow_exception(exception);
+        } catch (const std::exception& e) {
+            return dispatch(e);
+        } catch (...) {
+            return dispatchUnknown();
+        }
+    }
+
+private:
+    static constexpr std::size_t kNoHandler = ~std::size_t{0};
+    static constexpr std::size_t kCacheSlots = 64;   // power of two
+
+    struct Registration {
+        const std::type_info* type = nullptr;
+        bool (*matches)(const std::exception&) = nullptr;
+        void (*throwPointer)() = nullptr;
+        bool (*catchesPointer)(void (*)()) = nullptr;
+        std::function<void(const std::exception&)> handler;
+    };
+
+    // Handler chosen for one dynamic exception type.
+    struct Resolution {
+        const std::type_info* type;
+        std::size_t handler;
+    };
+
+    template <typename E>
+    static const E& downcast(const std::exception& e) {
+        // static_cast is enough (the type matched already), except through a virtual base.
+        if constexpr (requires { static_cast<const E&>(e); }) {
+            return static_cast<const E&>(e);
+        } else {
+            return dynamic_cast<const E&>(e);
+        }
+    }
+
+    // Does the registration a derive from the registration b? Both are only types, there is no object of a:
+    // throw a null a-pointer and see if a handler for b-pointers catches it (the conversion a* -> b* is
+    // exactly "a derives from b"). Only used when a new type is resolved.
+    bool derivesFrom(std::size_t a, std::size_t b) const {
+        return registrations_[b].catchesPointer(registrations_[a].throwPointer);
+    }
+
+    std::size_t resolve(const std::type_info& type, const std::exception& e) const {
+        // Fast path: one slot per type_info address, no lock.
+        std::atomic<const Resolution*>& slot = cache_[slotOf(type)];
+        const Resolution* cached = slot.load(std::memory_order_acquire);
+        if (cached != nullptr && (cached->type == &type || *cached->type == type)) {
+            return cached->handler;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = resolved_.find(std::type_index(type));
+        if (it == resolved_.end()) {
+            it = resolved_.emplace(std::type_index(type), Resolution{&type, mostDerivedMatch(e)}).first;
+        }
+        // Nodes of an unordered_map never move, so other threads can keep using the pointer.
+        slot.store(&it->second, std::memory_order_release);
+        return it->second.handler;
+    }
+
+    std::size_t mostDerivedMatch(const std::exception& e) const {
+        std::size_t best = kNoHandler;
+        for (std::size_t i = 0; i < registrations_.size(); ++i) {
+            if (registrations_[i].matches(e) && (best == kNoHandler || derivesFrom(i, best))) {
+                best = i;
+            }
+        }
+        return best;
+    }
+
+    static std::size_t slotOf(const std::type_info& type) noexcept {
+        const auto address = reinterpret_cast<std::uintptr_t>(&type);
+        return static_cast<std::size_t>((address >> 4) ^ (address >> 10)) & (kCacheSlots - 1);
+    }
+
+    void clearCache() {
+        for (auto& slot : cache_) {
+            slot.store(nullptr, std::memory_order_relaxed);
+        }
+        resolved_.clear();
+    }
+
+    std::vector<Registration> registrations_;
+    std::unordered_map<std::type_index, std::size_t> byType_;
+    std::function<void()> unknown_;
+
+    mutable std::mutex mutex_;
+    mutable std::unordered_map<std::type_index, Resolution> resolved_;
+    mutable std::atomic<const Resolution*> cache_[kCacheSlots] = {};
+};
+
+#endif //EXCEPTIONHANDLING_EXCEPTION_HANDLERS_H
@@ -0,0 +1,312 @@
+#ifndef EXCEPTIONHANDLING_EXCEPTION_LOG_H
+#define EXCEPTIONHANDLING_EXCEPTION_LOG_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <typeinfo>
+
+#if defined(__GNUG__)
+#include <cxxabi.h>
+#endif
+
+#include "throw_helpers.h"
+
+// Rate-limited logging of caught exceptions.
+// Every catch block in main() prints the exception with std::cout. That is fine for one failure,
+// but when thousands of withdrawals per second fail, the error storm becomes an I/O storm.
+//
+// ExceptionLog writes a caught exception only while its token bucket has tokens.
+// There is one bucket per throw site (the catch block that logs) and exception type,
+// so a storm of InsufficientFundsException does not silence a rare InvalidAmountException.
+// The buckets belong to the logger: two loggers that log through the same site limit and count it separately.
+// Suppressed exceptions are only counted, and a summary line per site and type is written periodically:
+//
+//     [main.cpp:42] InsufficientFundsException: Insufficient funds
+//     [main.cpp:42] InsufficientFundsException: 18342 similar exceptions suppressed
+//
+// The decision whether to write is lock-free (one compare-and-swap on the bucket).
+// Only the lines that are actually written take the mutex that protects the output stream.
+//
+// Usage in a catch block:
+//
+//     catch (const std::exception& e) {
+//         LOG_CAUGHT_EXCEPTION(log, e);
+//     }
+
+struct ExceptionLogConfig {
+    double linesPerSecond = 10.0;                        // sustained rate per site and exception type
+    std::uint32_t burst = 20;                            // lines allowed at once before the rate applies
+    std::chrono::milliseconds summaryInterval{1000};     // how often suppressed counts are written
+    std::size_t maxSites = 256;                          // sites with buckets of their own, the rest share one
+};
+
+// A logging call site. Created as a function-local static by LOG_CAUGHT_EXCEPTION; it is only the file and line,
+// the counters for it are kept by each ExceptionLog that logs through it.
+class ExceptionLogSite {
+public:
+    ExceptionLogSite(const char* file, int line) : file_(file), line_(line) {}
+
+    ExceptionLogSite(const ExceptionLogSite&) = delete;
+    ExceptionLogSite& operator=(const ExceptionLogSite&) = delete;
+
+private:
+    friend class ExceptionLog;
+
+    const char* file_;
+    int line_;
+};
+
+class ExceptionLog {
+public:
+    explicit ExceptionLog(std::ostream& out, ExceptionLogConfig config = {})
+        : out_(out),
+          config_(config),
+          intervalNs_(intervalNsFor(config.linesPerSecond)),
+          burstNs_(intervalNs_ * static_cast<std::int64_t>(config.burst > 0 ? config.burst - 1 : 0)),
+          nextSummaryNs_(nowNs() + summaryIntervalNs()),
+          siteMask_(tableSize(config.maxSites) - 1),
+          sites_(std::make_unique<SiteState[]>(siteMask_ + 1)) {}
+
+    ExceptionLog(const ExceptionLog&) = delete;
+    ExceptionLog& operator=(const ExceptionLog&) = delete;
+
+    // Log a caught exception. Returns true if a line was written, false if it was only counted.
+    bool log(ExceptionLogSite& site, const std::exception& e) {
+        return log(site, typeid(e), e.what());
+    }
+
+    // For catch (...) blocks.
+    bool logUnknown(ExceptionLogSite& site) {
+        return log(site, typeid(void), "Unknown exception");
+    }
+
+    // Write the suppressed counts of all sites and reset them.
+    // log() calls this by itself once per summaryInterval, call it directly e.g. at shutdown.
+    void flushSuppressed() {
+        for (std::size_t i = 0; i <= siteMask_; ++i) {
+            flushSite(sites_[i]);
+        }
+        flushSite(overflow_);
+    }
+
+    // Total number of exceptions that were counted instead of written, since the last flush.
+    std::uint64_t pendingSuppressed() const noexcept {
+        std::uint64_t total = 0;
+        for (std::size_t i = 0; i <= siteMask_; ++i) {
+            total += sites_[i].suppressed();
+        }
+        return total + overflow_.suppressed();
+    }
+
+private:
+    // Token bucket, implemented as "generic cell rate algorithm": instead of a token count and a refill time
+    // we keep the theoretical arrival time of the next line. A line is allowed while that time is not further
+    // in the future than the burst allows. Both are one 64-bit value, so one CAS updates the bucket.
+    struct Bucket {
+        std::atomic<const std::type_info*> type{nullptr};
+        std::atomic<std::int64_t> nextArrivalNs{0};
+        std::atomic<std::uint64_t> suppressed{0};
+    };
+
+    // Exception types are claimed lock-free in the first free slot. A site that sees more types than slots
+    // shares the last slot for the rest.
+    static constexpr std::size_t kTypesPerSite = 8;
+
+    // The buckets of one site in this logger. The table slot is claimed lock-free by the first log() through
+    // the site; the sites themselves are statics and outlive the logger.
+    struct SiteState {
+        std::atomic<const ExceptionLogSite*> site{nullptr};
+        std::array<Bucket, kTypesPerSite> buckets;
+
+        Bucket& bucketFor(const std::type_info& type) noexcept {
+            for (auto& bucket : buckets) {
+                const std::type_info* current = bucket.type.load(std::memory_order_acquire);
+                if (current == nullptr) {
+                    const std::type_info* expected = nullptr;
+                    if (bucket.type.compare_exchange_strong(expected, &type, std::memory_order_acq_rel)) {
+                        return bucket;
+                    }
+                    current = expected;
+                }
+                if (*current == type) {
+                    return bucket;
+                }
+            }
+            return buckets.back();
+        }
+
+        std::uint64_t suppressed() const noexcept {
+            std::uint64_t total = 0;
+            for (const auto& bucket : buckets) {
+                total += bucket.suppressed.load(std::memory_order_relaxed);
+            }
+            return total;
+        }
+    };
+
+    static std::int64_t intervalNsFor(double linesPerSecond) {
+        if (!(linesPerSecond > 0.0)) {
+            throw_invalid_argument("ExceptionLog: linesPerSecond must be positive");
+        }
+        return std::max<std::int64_t>(static_cast<std::int64_t>(1e9 / linesPerSecond), 1);
+    }
+
+    // Twice the sites, rounded up to a power of two, keeps the probe sequences short.
+    static std::size_t tableSize(std::size_t maxSites) noexcept {
+        std::size_t size = 16;
+        while (size < 2 * maxSites) {
+            size *= 2;
+        }
+        return size;
+    }
+
+    // Linear probing on the site's address. A full table sends the remaining sites to one shared overflow entry.
+    SiteState& stateFor(const ExceptionLogSite& site) noexcept {
+        std::size_t index = (reinterpret_cast<std::uintptr_t>(&site) >> 4) * 0x9e3779b97f4a7c15ULL >> 32;
+        for (std::size_t probe = 0; probe <= siteMask_; ++probe, ++index) {
+            SiteState& state = sites_[index & siteMask_];
+            const ExceptionLogSite* current = state.site.load(std::memory_order_acquire);
+            if (current == nullptr) {
+                if (claimed_.fetch_add(1, std::memory_order_relaxed) >= config_.maxSites) {
+                    claimed_.fetch_sub(1, std::memory_order_relaxed);
+                    break;
+                }
+                const ExceptionLogSite* expected = nullptr;
+                if (state.site.compare_exchange_strong(expected, &site, std::memory_order_acq_rel)) {
+                    return state;
+                }
+                claimed_.fetch_sub(1, std::memory_order_relaxed);
+                current = expected;
+            }
+            if (current == &site) {
+                return state;
+            }
+        }
+        return overflow_;
+    }
+
+    void flushSite(SiteState& state) {
+        const ExceptionLogSite* site = state.site.load(std::memory_order_acquire);
+        if (site == nullptr && &state != &overflow_) {
+            return;
+        }
+        for (auto& bucket : state.buckets) {
+            const std::type_info* type = bucket.type.load(std::memory_order_acquire);
+            if (type == nullptr) {
+                break;
+            }
+            const std::uint64_t suppressed = bucket.suppressed.exchange(0, std::memory_order_relaxed);
+            if (suppressed != 0) {
+                std::lock_guard<std::mutex> lock(outMutex_);
+                out_ << '[';
+                if (site != nullptr) {
+                    out_ << site->file_ << ':' << site->line_;
+                } else {
+                    out_ << "other sites";
+                }
+                out_ << "] " << typeName(*type) << ": " << suppressed << " similar exceptions suppressed" << std::endl;
+            }
+        }
+    }
+
+    static std::int64_t nowNs() noexcept {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    std::int64_t summaryIntervalNs() const noexcept {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(config_.summaryInterval).count();
+    }
+
+    bool log(ExceptionLogSite& site, const std::type_info& type, const char* message) {
+        SiteState& state = stateFor(site);
+        const std::int64_t now = nowNs();
+        maybeFlush(now);
+
+        Bucket& bucket = state.bucketFor(type);
+        if (!tryAcquire(bucket, now)) {
+            bucket.suppressed.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(outMutex_);
+        out_ << '[' << site.file_ << ':' << site.line_ << "] " << typeName(type) << ": " << message << std::endl;
+        return true;
+    }
+
+    bool tryAcquire(Bucket& bucket, std::int64_t now) const noexcept {
+        std::int64_t next = bucket.nextArrivalNs.load(std::memory_order_relaxed);
+        for (;;) {
+            if (next - now > burstNs_) {
+                return false;
+            }
+            const std::int64_t updated = (next > now ? next : now) + intervalNs_;
+            if (bucket.nextArrivalNs.compare_exchange_weak(next, updated, std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+    }
+
+    // Exactly one thread wins the CAS and writes the summary, the others go on.
+    void maybeFlush(std::int64_t now) {
+        std::int64_t due = nextSummaryNs_.load(std::memory_order_relaxed);
+        if (now < due) {
+            return;
+        }
+        if (nextSummaryNs_.compare_exchange_strong(due, now + summaryIntervalNs(), std::memory_order_relaxed)) {
+            flushSuppressed();
+        }
+    }
+
+    static std::string typeName(const std::type_info& type) {
+        if (type == typeid(void)) {
+            return "unknown";
+        }
+#if defined(__GNUG__)
+        int status = 0;
+        std::unique_ptr<char, void (*)(void*)> demangled(
+            abi::__cxa_demangle(type.name(), nullptr, nullptr, &status), std::free);
+        if (status == 0 && demangled) {
+            return demangled.get();
+        }
+#endif
+        return type.name();
+    }
+
+    std::ostream& out_;
+    ExceptionLogConfig config_;
+    std::int64_t intervalNs_;
+    std::int64_t burstNs_;
+    std::atomic<std::int64_t> nextSummaryNs_;
+    std::size_t siteMask_;
+    std::unique_ptr<SiteState[]> sites_;
+    SiteState overflow_;                     // its site stays nullptr
+    std::atomic<std::size_t> claimed_{0};
+    std::mutex outMutex_;
+};
+
+// Log the exception caught in the current catch block through a call site of its own.
+#define LOG_CAUGHT_EXCEPTION(logger, e)                                      \
+    do {                                                                    \
+        static ExceptionLogSite exceptionLogSite_(__FILE__, __LINE__);      \
+        (logger).log(exceptionLogSite_, (e));                               \
+    } while (0)
+
+// Same for a catch (...) block.
+#define LOG_CAUGHT_UNKNOWN(logger)                                          \
+    do {                                                                    \
+        static ExceptionLogSite exceptionLogSite_(__FILE__, __LINE__);      \
+        (logger).logUnknown(exceptionLogSite_);                             \
+    } while (0)
+
+#endif //EXCEPTIONHANDLING_EXCEPTION_LOG_H
@@ -0,0 +1,158 @@
+#ifndef EXCEPTIONHANDLING_EXCEPTIONS_H
+#define EXCEPTIONHANDLING_EXCEPTIONS_H
+
+#include <exception>
+#include <stdexcept>
+#include <system_error>
+
+#include "error_codes.h"
+
+// Here I give example on how to create your own exception class use by inheriting from base class std::exception class.
+// Custom exception class for demonstrating user-defined exceptions, inheriting from std::exception
+// The what() function is a virtual member function defined in the std::exception class.
+// By overriding it in our derived class, such as MyException, we can provide a custom implementation of the function that returns a C-style string describing the exception.
+//
+//This is useful because different types of exceptions may have different error messages or additional information that we want to convey to the user.
+// By overriding the what() function, we can customize the exception message for our specific exception class.
+class MyException : public std::exception {
+public:
+    // Override the what() function to provide a custom exception message
+    // The const noexcept qualifiers indicate that the function is const and noexcept,
+    // meaning it won't modify the object's state and won't throw any exceptions.
+    // As it is implemented in source code since 2011.
+    const char* what() const noexcept override {
+        return "My Exception occurred!";
+    }
+};
+
+// Custom exception class for division by zero
+// Two classic example, you need to handle exceptions, and implement your own custom class for handling exceptions.
+// Both also carry an error code (error_codes.h), the same one try_calculate_avg() returns.
+class DivideByZeroException : public std::exception, public CodedError {
+public:
+    const char* what() const noexcept override {
+        return "Division by zero exception";
+    }
+
+    std::error_code code() const noexcept override {
+        return ArithmeticError::DivideByZero;
+    }
+};
+
+// Custom exception class for negative sum or total
+class NegativeValueException : public std::exception, public CodedError {
+public:
+    const char* what() const noexcept override {
+        return "Negative value exception";
+    }
+
+    std::error_code code() const noexcept override {
+        return ArithmeticError::NegativeValue;
+    }
+};
+
+// Exception classes used by BankAccount.
+// They derive from the standard exceptions BankAccount used to throw, so a catch (const std::invalid_argument&)
+// or catch (const std::runtime_error&) block still catches them, but they also carry the numbers involved
+// and the AccountStatus the non-throwing operations return in the same situation, as code().
+
+// Deposit or withdrawal amount that is zero or negative.
+class InvalidAmountException : public std::invalid_argument, public CodedError {
+public:
+    InvalidAmountException(const char* message, double amount)
+        : std::invalid_argument(message), amount_(amount) {}
+
+    double amount() const noexcept { return amount_; }
+    std::error_code code() const noexcept override { return AccountStatus::InvalidAmount; }
+
+private:
+    double amount_;
+};
+
+// Withdrawal of more money than the account holds.
+class InsufficientFundsException : public std::runtime_error, public CodedError {
+public:
+    InsufficientFundsException(double amount, double balance)
+        : std::runtime_error("Insufficient funds"), amount_(amount), balance_(balance) {}
+
+    double amount() const noexcept { return amount_; }
+    double balance() const noexcept { return balance_; }
+    std::error_code code() const noexcept override { return AccountStatus::InsufficientFunds; }
+
+private:
+    double amount_;
+    double balance_;
+};
+
+// Operation on an account id that is not registered (account_registry.h).
+class UnknownAccountException : public std::out_of_range, public CodedError {
+public:
+    explicit UnknownAccountException(unsigned long long accountId)
+        : std::out_of_range("Unknown account"), accountId_(accountId) {}
+
+    unsigned long long accountId() const noexcept { return accountId_; }
+    std::error_code code() const noexcept override { return AccountStatus::UnknownAccount; }
+
+private:
+    unsigned long long accountId_;
+};
+
+// Withdrawal over a limit of the account kind, such as a daily cap (account_policies.h).
+class WithdrawalLimitException : public std::runtime_error, public CodedError {
+public:
+    WithdrawalLimitException(double amount, double remaining)
+        : std::runtime_error("Withdrawal limit exceeded"), amount_(amount), remaining_(remaining) {}
+
+    double amount() const noexcept { return amount_; }
+    double remaining() const noexcept { return remaining_; }
+    std::error_code code() const noexcept override { return AccountStatus::LimitExceeded; }
+
+private:
+    double amount_;
+    double remaining_;
+};
+
+// Withdrawal over a velocity limit: too many withdrawals, or too much withdrawn, in the recent window
+// (VelocityLimit, account_policies.h). Carries the window as it was before this withdrawal.
+class VelocityLimitException : public std::runtime_error, public CodedError {
+public:
+    VelocityLimitException(double amount, unsigned withdrawals, double withdrawn)
+        : std::runtime_error("Withdrawal velocity limit exceeded"),
+          amount_(amount), withdrawals_(withdrawals), withdrawn_(withdrawn) {}
+
+    double amount() const noexcept { return amount_; }
+    unsigned withdrawals() const noexcept { return withdrawals_; }
+    double withdrawn() const noexcept { return withdrawn_; }
+    std::error_code code() const noexcept override { return AccountStatus::VelocityExceeded; }
+
+private:
+    double amount_;
+    unsigned withdrawals_;
+    double withdrawn_;
+};
+
+// Exceptions of the throw helpers that are not about an account or arithmetic. There is no non-throwing operation
+// that returns these situations, so they have no enum of their own: code() is the std::errc value that describes
+// them, in std::generic_category(), the category of the std::system_error file errors as well.
+
+// Argument outside what a function accepts, other than an amount: a NaN statistics input, a reserved account id,
+// an interest rate of -100% or less, a logger configuration that makes no sense.
+class InvalidArgumentException : public std::invalid_argument, public CodedError {
+public:
+    explicit InvalidArgumentException(const char* message) : std::invalid_argument(message) {}
+
+    std::error_code code() const noexcept override { return std::make_error_code(std::errc::invalid_argument); }
+};
+
+// Failed invariant or misuse of an object (contracts.h): a bug, after which the state of the object cannot be
+// trusted any more.
+class ContractViolationException : public std::logic_error, public CodedError {
+public:
+    explicit ContractViolationException(const char* message) : std::logic_error(message) {}
+
+    std::error_code code() const noexcept override {
+        return std::make_error_code(std::errc::state_not_recoverable);
+    }
+};
+
+#endif //EXCEPTIONHANDLING_EXCEPTIONS_H
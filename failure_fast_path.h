@@ -0,0 +1,79 @@
+#ifndef EXCEPTIONHANDLING_FAILURE_FAST_PATH_H
+#define EXCEPTIONHANDLING_FAILURE_FAST_PATH_H
+
+#include <cstdint>
+
+#include "bank_account.h"
+#include "throw_helpers.h"
+
+// Throwing is cheap to write but not cheap to run: every throw walks the stack with the unwinder,
+// and the unwinder has to find the frame information of every function on the way
+// (with glibc through dl_iterate_phdr and a process wide lock).
+// When many threads fail at the same time, e.g. every worker gets "Insufficient funds", they queue up on that lock
+// and the number of handled failures per second stops growing with the number of threads.
+//
+// FailureFastPath keeps frequent failures off the throw path:
+//  - the fast path uses BankAccount::tryDeposit()/tryWithdraw() and records the failure in a per-thread slot (no lock, no unwinding),
+//  - every N-th failure on a thread still takes the slow path and throws the usual exception,
+//    so the code above us keeps seeing (a sample of) real exceptions in its catch blocks and logs.
+
+// How failures are reported by FailureFastPath.
+enum class FailureMode {
+    AlwaysThrow, // every failure throws, exactly like BankAccount::deposit()/withdraw()
+    FastPath,    // failures are returned as AccountStatus, one in sampleEvery throws
+};
+
+// Failures seen by the current thread on the fast path.
+struct ThreadFailureStats {
+    AccountStatus lastError = AccountStatus::Ok;
+    std::uint64_t failures = 0;   // all failures, thrown or not
+    std::uint64_t thrown = 0;     // failures that took the slow (throwing) path
+};
+
+class FailureFastPath {
+public:
+    explicit FailureFastPath(FailureMode mode = FailureMode::FastPath, std::uint32_t sampleEvery = 1024)
+        : mode_(mode), sampleEvery_(sampleEvery == 0 ? 1 : sampleEvery) {}
+
+    AccountStatus deposit(BankAccount& account, double amount) const {
+        const AccountStatus status = account.tryDeposit(amount);
+        if (status != AccountStatus::Ok) {
+            fail(status, "Invalid deposit amount", amount, account.getBalance());
+        }
+        return status;
+    }
+
+    AccountStatus withdraw(BankAccount& account, double amount) const {
+        const AccountStatus status = account.tryWithdraw(amount);
+        if (status != AccountStatus::Ok) {
+            fail(status, "Invalid withdrawal amount", amount, account.getBalance());
+        }
+        return status;
+    }
+
+    // Statistics of the calling thread.
+    static ThreadFailureStats& threadStats() noexcept {
+        thread_local ThreadFailureStats stats;
+        return stats;
+    }
+
+private:
+    void fail(AccountStatus status, const char* invalidAmountMessage, double amount, double balance) const {
+        ThreadFailureStats& stats = threadStats();
+        stats.lastError = status;
+        ++stats.failures;
+        if (mode_ == FailureMode::AlwaysThrow || stats.failures % sampleEvery_ == 0) {
+            ++stats.thrown;
+            // Same exceptions, same messages as BankAccount.
+            if (status == AccountStatus::InvalidAmount) {
+                throw_invalid_amount(invalidAmountMessage, amount);
+            }
+            throw_insufficient_funds(amount, balance);
+        }
+    }
+
+    FailureMode mode_;
+    std::uint32_t sampleEvery_;
+};
+
+#endif //EXCEPTIONHANDLING_FAILURE_FAST_PATH_H
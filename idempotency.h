@@ -0,0 +1,259 @@
+#ifndef EXCEPTIONHANDLING_IDEMPOTENCY_H
+#define EXCEPTIONHANDLING_IDEMPOTENCY_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "bank_account.h"
+
+// Idempotency keys: a client that retries a deposit or withdrawal (because the reply got lost, say) sends the same
+// key again, and the retry returns the result of the first attempt instead of moving the money twice.
+//
+//     IdempotencyCache seen(1'000'000, 60'000);            // up to 1M keys per generation of 60000 ticks
+//     AccountStatus status = seen.tryWithdraw(account, 50.0, requestKey, nowTicks);
+//
+// Key 0 means "no key": the operation just runs. A repeated key returns the stored AccountStatus without calling
+// the account (and without throwing, even if the first attempt failed). The key alone identifies the request;
+// a retry with a different amount still returns the first result.
+//
+// The keys are stored per generation. A generation covers generationTicks ticks, and the cache keeps the current
+// generation and the one before, so a key is remembered for at least generationTicks and at most twice that.
+// When the current generation holds keysPerGeneration keys, it starts the next one early, and the older keys are
+// forgotten sooner; the memory never grows.
+//
+// Each generation is an exact set: an open-addressing table of keys (linear probing) with the stored results in
+// a parallel byte array. In front of it is a blocked Bloom filter with 16 bits per key: the bits of a key are all
+// in one 64-byte block, so the check reads one cache line. Nearly every new key is rejected by the filters of both
+// generations, and only the rare false positive and real retries probe a table.
+//
+// Forgetting a generation must not clear it: that would take time in proportion to keysPerGeneration, all in the
+// one call that crosses the generation boundary. Instead every table slot and every filter block carries the tag of
+// the generation that wrote it, and a new generation only takes a new tag. A slot with an old tag counts as empty;
+// a block with an old tag as all zero bits, and the first insert into it resets it. The last word of a block holds
+// its tag, so a key's bits are in the other 448. (Tags are 32 bits; only when they wrap, after 2^32 generations,
+// is the generation cleared.)
+// Memory is about 20 bytes per key and generation: 2.3 for the filter, 17.3 for the table at load factor 3/4.
+//
+// Time is in ticks chosen by the caller, as in timer_wheel.h. Not thread-safe.
+class IdempotencyCache {
+public:
+    IdempotencyCache(std::size_t keysPerGeneration, std::uint64_t generationTicks)
+        : keysPerGeneration_(std::max<std::size_t>(keysPerGeneration, 1)),
+          generationTicks_(std::max<std::uint64_t>(generationTicks, 1)),
+          generations_{Generation(keysPerGeneration_), Generation(keysPerGeneration_)} {}
+
+    // Run operation() (returning AccountStatus) unless the key was seen before; then return the stored result.
+    template <typename Operation>
+    AccountStatus once(std::uint64_t key, std::uint64_t now, Operation&& operation) {
+        if (key == 0) {
+            return operation();
+        }
+        advanceTo(now);
+        const KeyHash hash = hashOf(key);
+        // The filter blocks and the slot a new key goes to are independent cache misses: start them all at once.
+        generations_[0].prefetch(hash);
+        generations_[1].prefetch(hash);
+        for (Generation& generation : generations_) {
+            if (generation.mayContain(hash)) {
+                if (const std::uint8_t* stored = generation.find(key, hash)) {
+                    ++duplicates_;
+                    return static_cast<AccountStatus>(*stored);
+                }
+                ++falsePositives_;
+            }
+        }
+        const AccountStatus status = operation();
+        if (generations_[current_].size >= keysPerGeneration_) {
+            rotate();
+        }
+        generations_[current_].insert(key, hash, static_cast<std::uint8_t>(status));
+        return status;
+    }
+
+    template <typename Account>
+    AccountStatus tryDeposit(Account& account, double amount, std::uint64_t key, std::uint64_t now) {
+        return once(key, now, [&] { return account.tryDeposit(amount); });
+    }
+
+    template <typename Account>
+    AccountStatus tryWithdraw(Account& account, double amount, std::uint64_t key, std::uint64_t now) {
+        return once(key, now, [&] { return account.tryWithdraw(amount); });
+    }
+
+    // Retries answered from the cache, and new keys that passed a Bloom filter anyway.
+    std::uint64_t duplicates() const noexcept { return duplicates_; }
+    std::uint64_t falsePositives() const noexcept { return falsePositives_; }
+
+    // Memory of both generations (filters, keys and results).
+    std::size_t bytes() const noexcept {
+        return generations_[0].bytes() + generations_[1].bytes();
+    }
+
+private:
+    static constexpr unsigned kBloomBitsPerKey = 16;
+    static constexpr unsigned kBloomHashes = 7;
+    static constexpr unsigned kBloomWords = 7;   // the eighth word of a block is its tag
+
+    struct alignas(64) BloomBlock {
+        std::uint64_t words[kBloomWords];
+        std::uint64_t tag;
+    };
+
+    // Where a key goes: one hash picks the filter block and the table slot, a second one the bits in the block,
+    // as a 448-bit mask built once per key.
+    struct KeyHash {
+        std::uint64_t position;
+        std::uint64_t bits[kBloomWords];
+    };
+
+    struct Generation {
+        explicit Generation(std::size_t capacity)
+            : bloom((capacity * kBloomBitsPerKey + kBloomWords * 64 - 1) / (kBloomWords * 64)),
+              keys(capacity + capacity / 3 + 1),   // load factor at most 3/4
+              tags(keys.size()),
+              results(keys.size()) {}
+
+        void prefetch(const KeyHash& hash) const noexcept {
+            __builtin_prefetch(&bloom[reduce(hash.position, bloom.size())]);
+            __builtin_prefetch(&keys[slotOf(hash)]);
+        }
+
+        // Compares all 7 words without branching: the result depends on random bits, a branch per bit would
+        // mostly be mispredicted.
+        bool mayContain(const KeyHash& hash) const noexcept {
+            const BloomBlock& block = bloom[reduce(hash.position, bloom.size())];
+            std::uint64_t missing = 0;
+            for (unsigned word = 0; word < kBloomWords; ++word) {
+                missing |= hash.bits[word] & ~block.words[word];
+            }
+            return missing == 0 && block.tag == tag;
+        }
+
+        // Slots are filled in probe order and never emptied within a generation, so the first slot with an old tag
+        // ends the search.
+        const std::uint8_t* find(std::uint64_t key, const KeyHash& hash) const noexcept {
+            for (std::size_t index = slotOf(hash);; index = next(index)) {
+                if (tags[index] != tag) {
+                    return nullptr;
+                }
+                if (keys[index] == key) {
+                    return &results[index];
+                }
+            }
+        }
+
+        void insert(std::uint64_t key, const KeyHash& hash, std::uint8_t result) noexcept {
+            BloomBlock& block = bloom[reduce(hash.position, bloom.size())];
+            if (block.tag != tag) {
+                block = BloomBlock{};
+                block.tag = tag;
+            }
+            for (unsigned word = 0; word < kBloomWords; ++word) {
+                block.words[word] |= hash.bits[word];
+            }
+            std::size_t index = slotOf(hash);
+            while (tags[index] == tag) {
+                index = next(index);
+            }
+            keys[index] = key;
+            tags[index] = tag;
+            results[index] = result;
+            ++size;
+        }
+
+        // Forget every key: a new tag, so nothing has to be cleared (only when the tag wraps around).
+        void clear() noexcept {
+            if (++tag == 0) {
+                std::fill(bloom.begin(), bloom.end(), BloomBlock{});
+                std::fill(tags.begin(), tags.end(), 0);
+                tag = 1;
+            }
+            size = 0;
+        }
+
+        std::size_t bytes() const noexcept {
+            return bloom.size() * sizeof(BloomBlock) +
+                   keys.size() * (sizeof(std::uint64_t) + sizeof(std::uint32_t) + sizeof(std::uint8_t));
+        }
+
+        // The block comes from the low half of hash.position, the slot from the high half.
+        std::size_t slotOf(const KeyHash& hash) const noexcept {
+            return reduce(hash.position >> 32, keys.size());
+        }
+
+        std::size_t next(std::size_t index) const noexcept {
+            return index + 1 == keys.size() ? 0 : index + 1;
+        }
+
+        std::vector<BloomBlock> bloom;
+        std::vector<std::uint64_t> keys;
+        std::vector<std::uint32_t> tags;   // the generation tag that wrote each slot; 0 is never a current tag
+        std::vector<std::uint8_t> results;
+        std::uint32_t tag = 1;
+        std::size_t size = 0;
+    };
+
+    // Map 32 bits of hash to [0, n) with a multiplication instead of a division ("fast range"),
+    // so the filter and the table can have any size, not only powers of two.
+    static std::size_t reduce(std::uint64_t hash, std::size_t n) noexcept {
+        return static_cast<std::size_t>(((hash & 0xffffffffULL) * n) >> 32);
+    }
+
+    // 7 groups of 9 bits of the second hash pick the bits in the block, scaled from [0, 512) to [0, 448).
+    static KeyHash hashOf(std::uint64_t key) noexcept {
+        KeyHash hash{mix(key), {}};
+        std::uint64_t bits = mix(hash.position ^ 0x9e3779b97f4a7c15ULL);
+        for (unsigned i = 0; i < kBloomHashes; ++i, bits >>= 9) {
+            const unsigned bit = static_cast<unsigned>(bits & 511) * kBloomWords / 8;
+            hash.bits[bit / 64] |= std::uint64_t{1} << (bit % 64);
+        }
+        return hash;
+    }
+
+    // splitmix64 finalizer, as in account_registry.h.
+    static std::uint64_t mix(std::uint64_t key) noexcept {
+        key ^= key >> 30;
+        key *= 0xbf58476d1ce4e5b9ULL;
+        key ^= key >> 27;
+        key *= 0x94d049bb133111ebULL;
+        key ^= key >> 31;
+        return key;
+    }
+
+    void advanceTo(std::uint64_t now) noexcept {
+        // Still the same generation (or a clock that went back): no division on the common path.
+        if (now < generationStart_ + generationTicks_) {
+            return;
+        }
+        const std::uint64_t generation = now / generationTicks_;
+        if (generation == generation_ + 1) {
+            rotate();
+        } else {
+            // Time jumped over a whole generation: every key is older than the window.
+            generations_[0].clear();
+            generations_[1].clear();
+        }
+        generation_ = generation;
+        generationStart_ = generation * generationTicks_;
+    }
+
+    // The older generation is forgotten and becomes the new current one; clear() only changes its tag.
+    void rotate() noexcept {
+        current_ ^= 1;
+        generations_[current_].clear();
+    }
+
+    std::size_t keysPerGeneration_;
+    std::uint64_t generationTicks_;
+    Generation generations_[2];
+    unsigned current_ = 0;
+    std::uint64_t generation_ = 0;
+    std::uint64_t generationStart_ = 0;
+    std::uint64_t duplicates_ = 0;
+    std::uint64_t falsePositives_ = 0;
+};
+
+#endif //EXCEPTIONHANDLING_IDEMPOTENCY_H
@@ -0,0 +1,531 @@
+#ifndef EXCEPTIONHANDLING_JOURNAL_H
+#define EXCEPTIONHANDLING_JOURNAL_H
+
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+// Durable journal of account operations (audit records).
+//
+// Writing every record with write() + fsync() costs two system calls and one disk flush per operation.
+// JournalWriter collects records in a few large buffers instead: append() only copies the record,
+// a full buffer is written in the background, and commit() makes everything appended so far durable with one flush
+// ("group commit"). How many operations share a flush is up to the caller: commit after every record,
+// or after a batch of requests.
+//
+// There are two backends:
+//   io_uring    Buffers are registered with the kernel once (no page pinning per write). A commit submits the last
+//               write linked to an fdatasync, so both go in with one io_uring_enter() that also waits for both
+//               completions. Completions of background writes are collected in batches from the completion ring.
+//               Uses the raw system calls from <linux/io_uring.h>, liburing is not needed.
+//   thread pool pwrite() of full buffers on worker threads, fdatasync() on commit.
+// openJournal() picks io_uring and falls back to the thread pool when the kernel does not offer it
+// (too old, or disabled, e.g. by a seccomp profile in a container).
+//
+// Journal records have a fixed size, so a journal can be read (and split for parallel replay) without parsing.
+// I/O failures are thrown as std::system_error.
+
+enum class JournalOp : std::uint8_t {
+    Open = 1,
+    Deposit = 2,
+    Withdraw = 3,
+};
+
+struct JournalRecord {
+    std::uint64_t sequence;   // set by append(): 0, 1, 2, ... in journal order
+    std::uint64_t account;
+    double amount;
+    double balanceAfter;
+    JournalOp op;
+    std::uint8_t status;      // AccountStatus of the operation, failed operations are audited too
+    std::uint16_t reserved;
+    std::uint32_t checksum;   // set by append(), see journalChecksum()
+};
+
+static_assert(sizeof(JournalRecord) == 40, "JournalRecord is the on-disk format");
+
+// FNV-1a over everything in the record before the checksum. Detects torn or half-written records at the end of a
+// journal after a crash, not deliberate tampering.
+inline std::uint32_t journalChecksum(const JournalRecord& record) noexcept {
+    unsigned char bytes[offsetof(JournalRecord, checksum)];
+    std::memcpy(bytes, &record, sizeof bytes);
+    std::uint32_t hash = 2166136261u;
+    for (unsigned char byte : bytes) {
+        hash = (hash ^ byte) * 16777619u;
+    }
+    return hash;
+}
+
+enum class JournalBackend {
+    Auto,
+    IoUring,
+    ThreadPool,
+};
+
+class JournalWriter {
+public:
+    JournalWriter(const JournalWriter&) = delete;
+    JournalWriter& operator=(const JournalWriter&) = delete;
+
+    virtual ~JournalWriter() {
+        if (fd_ >= 0) {
+            ::close(fd_);
+        }
+    }
+
+    // Add a record. It is durable after the next commit().
+    void append(JournalRecord record) {
+        record.sequence = appended_++;
+        record.checksum = journalChecksum(record);
+        if (fill_ + sizeof record > kBufferBytes) {
+            startWrite(false);
+        }
+        std::memcpy(buffer(current_) + fill_, &record, sizeof record);
+        fill_ += sizeof record;
+    }
+
+    // Return once every appended record is on stable storage.
+    void commit() {
+        if (fill_ > 0 || unsynced_) {
+            startWrite(true);
+            waitUntilIdle();
+            unsynced_ = false;
+        }
+    }
+
+    std::uint64_t appended() const noexcept { return appended_; }
+    virtual const char* backendName() const noexcept = 0;
+
+protected:
+    static constexpr unsigned kBuffers = 8;
+    // A whole number of records, so that no record is split between two writes.
+    static constexpr std::size_t kBufferBytes = (64 * 1024) / sizeof(JournalRecord) * sizeof(JournalRecord);
+
+    explicit JournalWriter(int fd) : fd_(fd) {}
+
+    // Backend interface. write() starts writing bytes of the buffer at offset; with sync, an fdatasync follows
+    // once this and all earlier writes are done. bytes can be 0 for a sync alone.
+    // waitForBuffer() returns once one more buffer is free, waitUntilIdle() once all I/O is done.
+    // Both call release() for every finished buffer and throw on I/O errors.
+    virtual char* buffer(unsigned index) noexcept = 0;
+    virtual void write(unsigned index, std::size_t bytes, std::uint64_t offset, bool sync) = 0;
+    virtual void waitForBuffer() = 0;
+    virtual void waitUntilIdle() = 0;
+
+    void release(unsigned index) noexcept {
+        busy_[index] = false;
+    }
+
+    int fd_;
+
+private:
+    void startWrite(bool sync) {
+        if (fill_ > 0) {
+            busy_[current_] = true;
+        }
+        write(current_, fill_, offset_, sync);
+        offset_ += fill_;
+        unsynced_ = !sync;
+        fill_ = 0;
+        current_ = nextFreeBuffer();
+    }
+
+    unsigned nextFreeBuffer() {
+        for (;;) {
+            for (unsigned i = 0; i < kBuffers; ++i) {
+                if (!busy_[i]) {
+                    return i;
+                }
+            }
+            waitForBuffer();
+        }
+    }
+
+    bool busy_[kBuffers] = {};
+    unsigned current_ = 0;
+    std::size_t fill_ = 0;
+    std::uint64_t offset_ = 0;
+    std::uint64_t appended_ = 0;
+    bool unsynced_ = false;
+};
+
+class IoUringJournal final : public JournalWriter {
+public:
+    // Throws std::system_error when io_uring cannot be set up (see openJournal() for the fallback).
+    explicit IoUringJournal(int fd) : JournalWriter(fd) {
+        io_uring_params params{};
+        ring_ = static_cast<int>(::syscall(__NR_io_uring_setup, kEntries, &params));
+        if (ring_ < 0) {
+            throw std::system_error(errno, std::generic_category(), "io_uring_setup");
+        }
+        try {
+            mapRings(params);
+            registerBuffers();
+        } catch (...) {
+            cleanup();
+            throw;
+        }
+    }
+
+    ~IoUringJournal() override {
+        try {
+            waitUntilIdle();
+        } catch (...) {
+            // Destructors must not throw; whoever needed durability called commit().
+        }
+        cleanup();
+    }
+
+    const char* backendName() const noexcept override { return "io_uring"; }
+
+protected:
+    char* buffer(unsigned index) noexcept override {
+        return memory_ + index * kBufferBytes;
+    }
+
+    void write(unsigned index, std::size_t bytes, std::uint64_t offset, bool sync) override {
+        // Drain makes the entry wait until all earlier ones completed, so the fsync also covers background writes.
+        // It serializes the ring, so only use it when there are background writes in flight.
+        const std::uint8_t drain = inFlight_ > 0 ? IOSQE_IO_DRAIN : 0;
+        unsigned submitted = 0;
+        if (bytes > 0) {
+            io_uring_sqe& sqe = nextSqe();
+            sqe.opcode = IORING_OP_WRITE_FIXED;
+            sqe.fd = fd_;
+            sqe.off = offset;
+            sqe.addr = reinterpret_cast<std::uint64_t>(buffer(index));
+            sqe.len = static_cast<std::uint32_t>(bytes);
+            sqe.buf_index = static_cast<std::uint16_t>(index);
+            sqe.user_data = index;
+            writeBytes_[index] = bytes;
+            if (sync) {
+                // Link: the fsync starts only after this write succeeded.
+                sqe.flags = drain | IOSQE_IO_LINK;
+            }
+            ++submitted;
+        }
+        if (sync) {
+            io_uring_sqe& sqe = nextSqe();
+            sqe.opcode = IORING_OP_FSYNC;
+            sqe.fd = fd_;
+            sqe.fsync_flags = IORING_FSYNC_DATASYNC;
+            sqe.user_data = kSyncTag;
+            if (bytes == 0) {
+                sqe.flags = drain;
+            }
+            ++submitted;
+        }
+        inFlight_ += submitted;
+        // A commit submits and waits with the same system call; background writes are only submitted.
+        enter(submitted, sync ? inFlight_ : 0);
+    }
+
+    void waitForBuffer() override {
+        enter(0, 1);
+    }
+
+    void waitUntilIdle() override {
+        while (inFlight_ > 0) {
+            enter(0, inFlight_);
+        }
+    }
+
+private:
+    static constexpr unsigned kEntries = 32;
+    static constexpr std::uint64_t kSyncTag = ~std::uint64_t{0};
+
+    void mapRings(const io_uring_params& params) {
+        if ((params.features & IORING_FEAT_SINGLE_MMAP) == 0) {
+            throw std::system_error(ENOSYS, std::generic_category(), "io_uring without IORING_FEAT_SINGLE_MMAP");
+        }
+        ringBytes_ = std::max<std::size_t>(params.sq_off.array + params.sq_entries * sizeof(std::uint32_t),
+                                           params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+        void* ring = ::mmap(nullptr, ringBytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_,
+                            IORING_OFF_SQ_RING);
+        if (ring == MAP_FAILED) {
+            throw std::system_error(errno, std::generic_category(), "mmap io_uring");
+        }
+        ringMemory_ = static_cast<char*>(ring);
+        sqeBytes_ = params.sq_entries * sizeof(io_uring_sqe);
+        void* sqes = ::mmap(nullptr, sqeBytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_,
+                            IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) {
+            throw std::system_error(errno, std::generic_category(), "mmap io_uring sqes");
+        }
+        sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+        sqTail_ = reinterpret_cast<std::uint32_t*>(ringMemory_ + params.sq_off.tail);
+        sqMask_ = *reinterpret_cast<std::uint32_t*>(ringMemory_ + params.sq_off.ring_mask);
+        sqArray_ = reinterpret_cast<std::uint32_t*>(ringMemory_ + params.sq_off.array);
+        cqHead_ = reinterpret_cast<std::uint32_t*>(ringMemory_ + params.cq_off.head);
+        cqTail_ = reinterpret_cast<std::uint32_t*>(ringMemory_ + params.cq_off.tail);
+        cqMask_ = *reinterpret_cast<std::uint32_t*>(ringMemory_ + params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(ringMemory_ + params.cq_off.cqes);
+    }
+
+    void registerBuffers() {
+        memory_ = static_cast<char*>(std::aligned_alloc(4096, (kBuffers * kBufferBytes + 4095) / 4096 * 4096));
+        if (memory_ == nullptr) {
+            throw std::bad_alloc();
+        }
+        iovec vectors[kBuffers];
+        for (unsigned i = 0; i < kBuffers; ++i) {
+            vectors[i].iov_base = buffer(i);
+            vectors[i].iov_len = kBufferBytes;
+        }
+        if (::syscall(__NR_io_uring_register, ring_, IORING_REGISTER_BUFFERS, vectors, kBuffers) != 0) {
+            throw std::system_error(errno, std::generic_category(), "io_uring_register");
+        }
+    }
+
+    io_uring_sqe& nextSqe() noexcept {
+        // The ring has room: at most kBuffers writes plus one fsync are in flight.
+        // Without SQPOLL the kernel only looks at the entry in io_uring_enter(), so the caller can fill it in after
+        // the tail moved.
+        const std::uint32_t tail = *sqTail_;
+        const std::uint32_t index = tail & sqMask_;
+        io_uring_sqe& sqe = sqes_[index];
+        std::memset(&sqe, 0, sizeof sqe);
+        sqArray_[index] = index;
+        std::atomic_ref<std::uint32_t>(*sqTail_).store(tail + 1, std::memory_order_release);
+        return sqe;
+    }
+
+    // Submit and/or wait, then collect all completions that are there.
+    void enter(unsigned submit, unsigned waitFor) {
+        for (;;) {
+            const long result = ::syscall(__NR_io_uring_enter, ring_, submit, waitFor,
+                                          waitFor > 0 ? IORING_ENTER_GETEVENTS : 0u, nullptr, 0);
+            if (result >= 0) {
+                break;
+            }
+            // EINTR means the signal came before anything was submitted, so the same call can be repeated.
+            if (errno != EINTR) {
+                throw std::system_error(errno, std::generic_category(), "io_uring_enter");
+            }
+        }
+        reapCompletions();
+    }
+
+    void reapCompletions() {
+        std::uint32_t head = *cqHead_;
+        const std::uint32_t tail = std::atomic_ref<std::uint32_t>(*cqTail_).load(std::memory_order_acquire);
+        int error = 0;
+        for (; head != tail; ++head) {
+            const io_uring_cqe& cqe = cqes_[head & cqMask_];
+            if (cqe.res < 0 && error == 0) {
+                error = -cqe.res;
+            }
+            if (cqe.user_data != kSyncTag) {
+                const auto index = static_cast<unsigned>(cqe.user_data);
+                // A short write is an error too (the linked fsync is then cancelled).
+                if (cqe.res >= 0 && static_cast<std::size_t>(cqe.res) != writeBytes_[index] && error == 0) {
+                    error = EIO;
+                }
+                release(index);
+            }
+            --inFlight_;
+        }
+        std::atomic_ref<std::uint32_t>(*cqHead_).store(head, std::memory_order_release);
+        if (error != 0) {
+            throw std::system_error(error, std::generic_category(), "journal write");
+        }
+    }
+
+    void cleanup() noexcept {
+        if (sqes_ != nullptr) {
+            ::munmap(sqes_, sqeBytes_);
+        }
+        if (ringMemory_ != nullptr) {
+            ::munmap(ringMemory_, ringBytes_);
+        }
+        ::close(ring_);
+        std::free(memory_);
+    }
+
+    int ring_ = -1;
+    char* ringMemory_ = nullptr;
+    std::size_t ringBytes_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    std::size_t sqeBytes_ = 0;
+    std::uint32_t* sqTail_ = nullptr;
+    std::uint32_t sqMask_ = 0;
+    std::uint32_t* sqArray_ = nullptr;
+    std::uint32_t* cqHead_ = nullptr;
+    std::uint32_t* cqTail_ = nullptr;
+    std::uint32_t cqMask_ = 0;
+    io_uring_cqe* cqes_ = nullptr;
+    char* memory_ = nullptr;
+    std::size_t writeBytes_[kBuffers] = {};
+    unsigned inFlight_ = 0;
+};
+
+class ThreadPoolJournal final : public JournalWriter {
+public:
+    explicit ThreadPoolJournal(int fd, unsigned threads = 2) : JournalWriter(fd), memory_(kBuffers * kBufferBytes) {
+        for (unsigned i = 0; i < threads; ++i) {
+            workers_.emplace_back([this] { work(); });
+        }
+    }
+
+    ~ThreadPoolJournal() override {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_all();
+        for (auto& worker : workers_) {
+            worker.join();
+        }
+    }
+
+    const char* backendName() const noexcept override { return "thread pool"; }
+
+protected:
+    char* buffer(unsigned index) noexcept override {
+        return memory_.data() + index * kBufferBytes;
+    }
+
+    void write(unsigned index, std::size_t bytes, std::uint64_t offset, bool sync) override {
+        if (bytes > 0) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                jobs_.push_back(Job{index, bytes, offset});
+                ++inFlight_;
+            }
+            wake_.notify_one();
+        }
+        if (sync) {
+            waitUntilIdle();
+            if (::fdatasync(fd_) != 0) {
+                throw std::system_error(errno, std::generic_category(), "fdatasync");
+            }
+        }
+    }
+
+    void waitForBuffer() override {
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [&] { return !finishedBuffers_.empty() || error_ != 0; });
+        collect(lock);
+    }
+
+    void waitUntilIdle() override {
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [&] { return inFlight_ == 0; });
+        collect(lock);
+    }
+
+private:
+    struct Job {
+        unsigned index;
+        std::size_t bytes;
+        std::uint64_t offset;
+    };
+
+    void work() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            wake_.wait(lock, [&] { return stopping_ || !jobs_.empty(); });
+            if (jobs_.empty()) {
+                return;
+            }
+            const Job job = jobs_.front();
+            jobs_.pop_front();
+            lock.unlock();
+            const int error = writeFully(job);
+            lock.lock();
+            if (error != 0 && error_ == 0) {
+                error_ = error;
+            }
+            finishedBuffers_.push_back(job.index);
+            --inFlight_;
+            done_.notify_all();
+        }
+    }
+
+    int writeFully(const Job& job) noexcept {
+        const char* data = buffer(job.index);
+        std::size_t written = 0;
+        while (written < job.bytes) {
+            const ssize_t n = ::pwrite(fd_, data + written, job.bytes - written,
+                                       static_cast<off_t>(job.offset + written));
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return errno;
+            }
+            written += static_cast<std::size_t>(n);
+        }
+        return 0;
+    }
+
+    // Hand finished buffers back and report the first error (called with the lock held).
+    void collect(std::unique_lock<std::mutex>&) {
+        for (unsigned index : finishedBuffers_) {
+            release(index);
+        }
+        finishedBuffers_.clear();
+        if (error_ != 0) {
+            const int error = error_;
+            error_ = 0;
+            throw std::system_error(error, std::generic_category(), "journal write");
+        }
+    }
+
+    std::vector<char> memory_;
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    std::deque<Job> jobs_;
+    std::vector<unsigned> finishedBuffers_;
+    unsigned inFlight_ = 0;
+    int error_ = 0;
+    bool stopping_ = false;
+};
+
+// Create (or truncate) a journal file.
+inline std::unique_ptr<JournalWriter> openJournal(const std::string& path,
+                                                  JournalBackend backend = JournalBackend::Auto) {
+    const auto openFile = [&](int flags) {
+        const int fd = ::open(path.c_str(), O_WRONLY | O_CLOEXEC | flags, 0644);
+        if (fd < 0) {
+            throw std::system_error(errno, std::generic_category(), path);
+        }
+        return fd;
+    };
+    const int fd = openFile(O_CREAT | O_TRUNC);
+    if (backend == JournalBackend::ThreadPool) {
+        return std::make_unique<ThreadPoolJournal>(fd);
+    }
+    try {
+        return std::make_unique<IoUringJournal>(fd);   // closes fd when it throws
+    } catch (const std::system_error&) {
+        if (backend == JournalBackend::IoUring) {
+            throw;
+        }
+    }
+    return std::make_unique<ThreadPoolJournal>(openFile(0));
+}
+
+#endif //EXCEPTIONHANDLING_JOURNAL_H
@@ -0,0 +1,354 @@
+#ifndef EXCEPTIONHANDLING_JOURNAL_REPLAY_H
+#define EXCEPTIONHANDLING_JOURNAL_REPLAY_H
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "account_protocol.h"
+#include "account_registry.h"
+#include "journal.h"
+
+// Rebuild the accounts at startup by replaying a journal (journal.h).
+//
+// Every record is turned back into its request and applied with handleRequest() (account_protocol.h), the code of
+// the account service itself: Open registers the account, Deposit and Withdraw call tryDeposit()/tryWithdraw() of
+// an AccountRegistry, with the same checks of the amounts.
+// So a withdrawal that failed with insufficient funds when it was journaled fails again, and the balances come out
+// the same. Where the outcome (or the balance after a successful operation) differs from what the journal recorded,
+// the record is counted as a mismatch. Replay stops at the first record that is torn (wrong checksum) or out of
+// sequence, which is where a crash cut the journal off.
+//
+//     const MappedJournal journal("accounts.journal");
+//     const JournalReplay accounts = replay_journal_parallel(journal, std::thread::hardware_concurrency());
+//     const double* balance = accounts.findBalance(42);
+//
+// The journal file is mapped into memory (mmap), not read: records are used in place, and the threads of a parallel
+// replay read their parts of the file without copying or locking.
+//
+// Parallel replay splits the accounts, not the journal: the outcome of an operation depends on the earlier
+// operations of the same account, and on nothing else. Account ids are hashed into one partition per thread,
+// and each thread replays the records of its partition in journal order into its own AccountRegistry:
+//   1. Split: the journal is cut into pieces of kReplayPiece records, which the threads take one by one.
+//      For each record they check checksum and sequence and note its index in the list of its partition.
+//   2. Apply: each thread goes through the lists of its partition, piece by piece, and applies the records.
+// Nothing is shared in step 2, so it needs no locks, and every account sees its operations in the same order as in
+// sequential replay. same_replay() compares two replays account by account.
+
+// Thrown by MappedJournal as std::system_error.
+class MappedJournal {
+public:
+    explicit MappedJournal(const std::string& path) {
+        fd_ = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd_ < 0) {
+            throw std::system_error(errno, std::generic_category(), path);
+        }
+        struct stat status {};
+        if (::fstat(fd_, &status) != 0) {
+            const int error = errno;
+            ::close(fd_);
+            throw std::system_error(error, std::generic_category(), path);
+        }
+        bytes_ = static_cast<std::size_t>(status.st_size);
+        if (bytes_ != 0) {
+            void* data = ::mmap(nullptr, bytes_, PROT_READ, MAP_PRIVATE, fd_, 0);
+            if (data == MAP_FAILED) {
+                const int error = errno;
+                ::close(fd_);
+                throw std::system_error(error, std::generic_category(), path);
+            }
+            ::madvise(data, bytes_, MADV_SEQUENTIAL);   // only a hint, the replay works without it
+            data_ = static_cast<const JournalRecord*>(data);
+        }
+    }
+
+    ~MappedJournal() {
+        if (data_ != nullptr) {
+            ::munmap(const_cast<JournalRecord*>(data_), bytes_);
+        }
+        ::close(fd_);
+    }
+
+    MappedJournal(const MappedJournal&) = delete;
+    MappedJournal& operator=(const MappedJournal&) = delete;
+
+    const JournalRecord* records() const noexcept { return data_; }
+    // Whole records; a partly written last record is not counted.
+    std::size_t size() const noexcept { return bytes_ / sizeof(JournalRecord); }
+
+private:
+    int fd_ = -1;
+    const JournalRecord* data_ = nullptr;
+    std::size_t bytes_ = 0;
+};
+
+// What a replay did. Every applied record is counted under exactly one outcome.
+struct ReplayStats {
+    std::size_t records = 0;             // applied: everything before the first torn or out-of-sequence record
+    std::size_t ok = 0;
+    std::size_t insufficientFunds = 0;
+    std::size_t invalidAmount = 0;
+    std::size_t unknownAccount = 0;
+    std::size_t accountExists = 0;       // Open of an account that is already there
+    std::size_t badRecords = 0;          // unknown operation, or Open of the reserved id
+    std::size_t mismatches = 0;          // outcome or balance differs from what the journal recorded
+
+    void add(const ReplayStats& other) noexcept {
+        records += other.records;
+        ok += other.ok;
+        insufficientFunds += other.insufficientFunds;
+        invalidAmount += other.invalidAmount;
+        unknownAccount += other.unknownAccount;
+        accountExists += other.accountExists;
+        badRecords += other.badRecords;
+        mismatches += other.mismatches;
+    }
+
+    bool operator==(const ReplayStats&) const = default;
+};
+
+// The rebuilt accounts: one AccountRegistry per partition (just one after sequential replay).
+struct JournalReplay {
+    ReplayStats stats;
+    bool complete = true;   // false if replay stopped before the end of the journal
+    std::vector<AccountRegistry> partitions;
+
+    // Balance of an account, or nullptr for an unknown id.
+    const double* findBalance(std::uint64_t account) const noexcept;
+
+    std::size_t accounts() const noexcept {
+        std::size_t total = 0;
+        for (const AccountRegistry& partition : partitions) {
+            total += partition.size();
+        }
+        return total;
+    }
+};
+
+// Records per piece of the split step; a record is found by its 32-bit index within its piece.
+inline constexpr std::size_t kReplayPiece = std::size_t{1} << 20;
+
+// How many records ahead replay starts loading the account (and twice as far ahead, the record itself).
+inline constexpr std::size_t kReplayPrefetch = 8;
+
+// Partition of an account: the high half of a splitmix64 hash. AccountRegistry uses the low bits of the same hash
+// for its slots, so the ids of one partition still spread over all slots of its registry.
+inline std::size_t replay_partition_of(std::uint64_t account, std::size_t partitions) noexcept {
+    account ^= account >> 30;
+    account *= 0xbf58476d1ce4e5b9ULL;
+    account ^= account >> 27;
+    account *= 0x94d049bb133111ebULL;
+    account ^= account >> 31;
+    return static_cast<std::size_t>(((account >> 32) * partitions) >> 32);
+}
+
+inline const double* JournalReplay::findBalance(std::uint64_t account) const noexcept {
+    if (partitions.empty()) {
+        return nullptr;
+    }
+    return partitions[replay_partition_of(account, partitions.size())].findBalance(account);
+}
+
+// Record at index in journal order that replay accepts: checksum intact and sequence number in place.
+inline bool replay_record_valid(const JournalRecord& record, std::size_t index) noexcept {
+    return record.sequence == index && record.checksum == journalChecksum(record);
+}
+
+// The request a journal record was made from. Ops that are not journaled get an opcode handleRequest() refuses.
+inline Request replay_request(const JournalRecord& record) noexcept {
+    Request request{};
+    request.requestId = record.sequence;
+    request.account = record.account;
+    request.amount = record.amount;
+    switch (record.op) {
+        case JournalOp::Open: request.opcode = Opcode::Open; break;
+        case JournalOp::Deposit: request.opcode = Opcode::Deposit; break;
+        case JournalOp::Withdraw: request.opcode = Opcode::Withdraw; break;
+        default: request.opcode = Opcode{0}; break;
+    }
+    return request;
+}
+
+// Apply one record with handleRequest(), so replay follows exactly the rules of the server, and count its outcome.
+inline void replay_record(AccountRegistry& registry, const JournalRecord& record, ReplayStats& stats) {
+    const Reply reply = handleRequest(registry, replay_request(record));
+    const ReplyStatus status = reply.status;
+    ++stats.records;
+    switch (status) {
+        case ReplyStatus::Ok: ++stats.ok; break;
+        case ReplyStatus::InsufficientFunds: ++stats.insufficientFunds; break;
+        case ReplyStatus::InvalidAmount: ++stats.invalidAmount; break;
+        case ReplyStatus::UnknownAccount: ++stats.unknownAccount; break;
+        case ReplyStatus::AccountExists: ++stats.accountExists; break;
+        default: ++stats.badRecords; break;
+    }
+    if (static_cast<std::uint8_t>(status) != record.status ||
+        (status == ReplyStatus::Ok && reply.balance != record.balanceAfter)) {
+        ++stats.mismatches;
+    }
+}
+
+// One record after the other, on the calling thread: the reference for replay_journal_parallel().
+// The registry is sized for the Open records first, as in parallel replay, so that neither has to grow its table.
+inline JournalReplay replay_journal_sequential(const MappedJournal& journal) {
+    const JournalRecord* records = journal.records();
+    const std::size_t opens = static_cast<std::size_t>(std::count_if(
+        records, records + journal.size(), [](const JournalRecord& record) { return record.op == JournalOp::Open; }));
+    JournalReplay replay;
+    replay.partitions.emplace_back(opens);
+    std::size_t index = 0;
+    for (; index < journal.size() && replay_record_valid(records[index], index); ++index) {
+        if (index + kReplayPrefetch < journal.size()) {
+            replay.partitions[0].prefetch(records[index + kReplayPrefetch].account);
+        }
+        replay_record(replay.partitions[0], records[index], replay.stats);
+    }
+    replay.complete = index == journal.size();
+    return replay;
+}
+
+namespace replay_detail {
+
+// Run work(worker) on threads workers, the last one on the calling thread, and rethrow the first exception.
+template <typename Work>
+void run_workers(std::size_t threads, Work work) {
+    std::exception_ptr failure;
+    std::mutex failureMutex;
+    const auto guarded = [&](std::size_t worker) {
+        try {
+            work(worker);
+        } catch (...) {
+            const std::lock_guard<std::mutex> lock(failureMutex);
+            if (!failure) {
+                failure = std::current_exception();
+            }
+        }
+    };
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+    for (std::size_t worker = 0; worker + 1 < threads; ++worker) {
+        pool.emplace_back(guarded, worker);
+    }
+    guarded(threads - 1);
+    for (std::thread& thread : pool) {
+        thread.join();
+    }
+    if (failure) {
+        std::rethrow_exception(failure);
+    }
+}
+
+// Result of the split step for one piece of the journal.
+struct Piece {
+    std::vector<std::vector<std::uint32_t>> indices;   // per partition, record indices within the piece
+    std::vector<std::size_t> opens;                    // per partition, Open records (to size the registries)
+    std::size_t valid = 0;                             // records before the first invalid one in this piece
+};
+
+} // namespace replay_detail
+
+// Replay with one partition per thread; threads = 1 still goes through both steps.
+inline JournalReplay replay_journal_parallel(const MappedJournal& journal, std::size_t threads) {
+    using replay_detail::Piece;
+    threads = std::max<std::size_t>(threads, 1);
+    const JournalRecord* records = journal.records();
+    const std::size_t total = journal.size();
+    std::vector<Piece> pieces((total + kReplayPiece - 1) / kReplayPiece);
+
+    // 1. Split.
+    std::atomic<std::size_t> nextPiece{0};
+    replay_detail::run_workers(threads, [&](std::size_t) {
+        for (std::size_t number; (number = nextPiece.fetch_add(1, std::memory_order_relaxed)) < pieces.size();) {
+            Piece& piece = pieces[number];
+            piece.indices.resize(threads);
+            piece.opens.assign(threads, 0);
+            const std::size_t begin = number * kReplayPiece;
+            const std::size_t end = std::min(begin + kReplayPiece, total);
+            for (auto& list : piece.indices) {
+                list.reserve((end - begin) / threads + (end - begin) / threads / 8 + 16);
+            }
+            std::size_t index = begin;
+            for (; index < end && replay_record_valid(records[index], index); ++index) {
+                const std::size_t partition = replay_partition_of(records[index].account, threads);
+                piece.indices[partition].push_back(static_cast<std::uint32_t>(index - begin));
+                piece.opens[partition] += records[index].op == JournalOp::Open;
+            }
+            piece.valid = index - begin;
+        }
+    });
+
+    // Everything up to the first invalid record is replayed, as in sequential replay.
+    JournalReplay replay;
+    std::size_t usablePieces = 0;
+    while (usablePieces < pieces.size()) {
+        const std::size_t pieceSize = std::min(kReplayPiece, total - usablePieces * kReplayPiece);
+        const std::size_t valid = pieces[usablePieces].valid;
+        ++usablePieces;
+        if (valid != pieceSize) {
+            replay.complete = false;
+            break;
+        }
+    }
+
+    // 2. Apply.
+    replay.partitions.resize(threads);
+    std::vector<ReplayStats> stats(threads);
+    replay_detail::run_workers(threads, [&](std::size_t partition) {
+        std::size_t opens = 0;
+        for (std::size_t number = 0; number < usablePieces; ++number) {
+            opens += pieces[number].opens[partition];
+        }
+        AccountRegistry registry(opens);
+        for (std::size_t number = 0; number < usablePieces; ++number) {
+            const JournalRecord* base = records + number * kReplayPiece;
+            const std::vector<std::uint32_t>& list = pieces[number].indices[partition];
+            // The split step noted only records before the first invalid one of each piece; in the last piece
+            // that is replayed, those are exactly the ones to apply.
+            for (std::size_t i = 0; i < list.size(); ++i) {
+                if (i + 2 * kReplayPrefetch < list.size()) {
+                    __builtin_prefetch(base + list[i + 2 * kReplayPrefetch]);
+                }
+                if (i + kReplayPrefetch < list.size()) {
+                    registry.prefetch(base[list[i + kReplayPrefetch]].account);
+                }
+                replay_record(registry, base[list[i]], stats[partition]);
+            }
+        }
+        replay.partitions[partition] = std::move(registry);
+    });
+    for (const ReplayStats& partitionStats : stats) {
+        replay.stats.add(partitionStats);
+    }
+    return replay;
+}
+
+// Whether two replays of the same journal (sequential, or with any number of threads) rebuilt the same accounts
+// with bit-identical balances and counted the same outcomes.
+inline bool same_replay(const JournalReplay& a, const JournalReplay& b) {
+    if (!(a.stats == b.stats) || a.complete != b.complete || a.accounts() != b.accounts()) {
+        return false;
+    }
+    bool same = true;
+    for (const AccountRegistry& partition : a.partitions) {
+        partition.forEach([&](std::uint64_t account, double balance) {
+            const double* other = b.findBalance(account);
+            same = same && other != nullptr && *other == balance;
+        });
+    }
+    return same;
+}
+
+#endif //EXCEPTIONHANDLING_JOURNAL_REPLAY_H
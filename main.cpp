@@ -1,5 +1,9 @@
 #include <iostream>
 
+#include "average.h"
+#include "bank_account.h"
+#include "exceptions.h"
+
 /*
  * Auther: Aman Arabzadeh
  * Exception Handling in C++
@@ -23,51 +27,10 @@
 
 // Exception Handling C++
 
+// The custom exception classes (MyException, DivideByZeroException, NegativeValueException) live in exceptions.h,
+// so that the other examples in this repository can reuse them.
 
-// Here I give example on how to create your own exception class use by inheriting from base class std::exception class.
-// Custom exception class for demonstrating user-defined exceptions, inheriting from std::exception
-// The what() function is a virtual member function defined in the std::exception class.
-// By overriding it in our derived class, such as MyException, we can provide a custom implementation of the function that returns a C-style string describing the exception.
-//
-//This is useful because different types of exceptions may have different error messages or additional information that we want to convey to the user.
-// By overriding the what() function, we can customize the exception message for our specific exception class.
-class MyException : public std::exception {
-public:
-    // Override the what() function to provide a custom exception message
-    // The const noexcept qualifiers indicate that the function is const and noexcept,
-    // meaning it won't modify the object's state and won't throw any exceptions.
-    // As it is implemented in source code since 2011.
-    const char* what() const noexcept override {
-        return "My Exception occurred!";
-    }
-};
-
-// Custom exception class for division by zero
-// Two classic example, you need to handle exceptions, and implement your own custom class for handling exceptions.
-class DivideByZeroException : public std::exception {
-public:
-    const char* what() const noexcept override {
-        return "Division by zero exception";
-    }
-};
-
-// Custom exception class for negative sum or total
-class NegativeValueException : public std::exception {
-public:
-    const char* what() const noexcept override {
-        return "Negative value exception";
-    }
-};
-
-double calculate_avg(int sum, int total) {
-    if (total == 0) {
-        throw DivideByZeroException();
-    }
-    if (sum < 0 || total < 0) {
-        throw NegativeValueException();
-    }
-    return static_cast<double>(sum) / total;
-}
+// calculate_avg() lives in average.h, it throws DivideByZeroException and NegativeValueException.
 
 
 // Exception Handling /  Stack Unwinding: C++
@@ -109,48 +72,7 @@ void firstLevel() {
 
 
 
-// BankAccount class with exception handling
-class BankAccount {
-private:
-    double balance;
-
-public:
-    BankAccount() : balance(0.0) {}
-
-    // Deposit money into the account
-    void deposit(double amount) {
-        // Check if the deposit amount is valid
-        if (amount <= 0.0) {
-            throw std::invalid_argument("Invalid deposit amount");
-        }
-
-        // Perform the deposit operation
-        balance += amount;
-        std::cout << "Deposit successful. Current balance: " << balance << std::endl;
-    }
-
-    // Withdraw money from the account
-    void withdraw(double amount) {
-        // Check if the withdrawal amount is valid
-        if (amount <= 0.0) {
-            throw std::invalid_argument("Invalid withdrawal amount");
-        }
-
-        // Check if there are sufficient funds for the withdrawal
-        if (amount > balance) {
-            throw std::runtime_error("Insufficient funds");
-        }
-
-        // Perform the withdrawal operation
-        balance -= amount;
-        std::cout << "Withdrawal successful. Current balance: " << balance << std::endl;
-    }
-
-    // Get the current account balance
-    double getBalance() const {
-        return balance;
-    }
-};
+// The BankAccount class with exception handling lives in bank_account.h
 
 ///
 
@@ -184,10 +106,11 @@ int main() {
     BankAccount account;
 
     try {
-        // Perform deposit and withdrawal operations
-        account.deposit(100.0);
-        account.withdraw(50.0);
-        account.withdraw(80.0); // This will throw an exception
+        // Perform deposit and withdrawal operations.
+        // The _amount literals (amount.h) are checked by the compiler, so these calls skip the amount check.
+        account.deposit(100.0_amount);
+        account.withdraw(50.0_amount);
+        account.withdraw(80.0_amount); // This will throw an exception
     } catch (const std::invalid_argument& e) {
         // Catch invalid argument exceptions and display the error message
         std::cout << "Invalid argument exception: " << e.what() << std::endl;
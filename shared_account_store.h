@@ -0,0 +1,292 @@
+#ifndef EXCEPTIONHANDLING_SHARED_ACCOUNT_STORE_H
+#define EXCEPTIONHANDLING_SHARED_ACCOUNT_STORE_H
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+#include "bank_account.h"
+#include "throw_helpers.h"
+
+// Account balances in POSIX shared memory, so several worker processes can deposit(), withdraw() and getBalance()
+// on the same accounts at the same time.
+//
+// The segment holds a header and an array of balances. Accounts are numbered 0 .. capacity-1
+// (use an AccountRegistry or similar in front of it for sparse external ids).
+// Each account is protected by one of kStripes process-shared mutexes (account % kStripes), so processes working on
+// different accounts rarely wait for each other.
+//
+// The mutexes are "robust": if a process dies while it holds one, the next process that locks it gets EOWNERDEAD
+// instead of waiting forever. Every operation changes a balance with a single store, so the balance is either
+// the old or the new value and still valid. The store marks the mutex consistent again and counts the recovery.
+//
+// Failures of the system calls themselves (shm_open, mmap, ...) are thrown as std::system_error.
+// The account rules are BankAccount's and use the same exceptions and AccountStatus values.
+//
+// Linux/POSIX only.
+
+class SharedAccountStore {
+public:
+    static constexpr std::size_t kStripes = 64;
+
+    // Create a new segment. Fails if one with this name exists already (call remove() for a stale one).
+    static SharedAccountStore create(const std::string& name, std::uint32_t capacity) {
+        const int fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd < 0) {
+            throwSystemError("shm_open");
+        }
+        const std::size_t bytes = segmentSize(capacity);
+        if (::ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+            const int error = errno;
+            ::close(fd);
+            ::shm_unlink(name.c_str());
+            throw std::system_error(error, std::generic_category(), "ftruncate");
+        }
+        void* mapping = mapOrClose(fd, bytes);
+        ::close(fd);
+        SharedAccountStore store(mapping, bytes);
+        store.initialize(capacity);
+        return store;
+    }
+
+    // Attach to a segment another process created. open() can race with create() in another process: until the
+    // creator has sized the segment (ftruncate) and set it up, open() waits. If that does not happen within
+    // timeout, say because the creator died half-way, it throws std::system_error with std::errc::timed_out;
+    // remove() the stale segment then.
+    static SharedAccountStore open(const std::string& name,
+                                   std::chrono::milliseconds timeout = std::chrono::milliseconds(5000)) {
+        const int fd = ::shm_open(name.c_str(), O_RDWR, 0600);
+        if (fd < 0) {
+            throwSystemError("shm_open");
+        }
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        SharedAccountStore store(nullptr, 0);
+        for (;;) {
+            struct stat info {};
+            if (::fstat(fd, &info) != 0) {
+                const int error = errno;
+                ::close(fd);
+                throw std::system_error(error, std::generic_category(), "fstat");
+            }
+            // Map again whenever the segment has grown; before the creator's ftruncate it is still 0 bytes.
+            const auto bytes = static_cast<std::size_t>(info.st_size);
+            if (bytes >= sizeof(Header) && bytes != store.bytes_) {
+                store = SharedAccountStore(mapOrClose(fd, bytes), bytes);
+            }
+            if (store.base_ != nullptr && store.header().ready.load(std::memory_order_acquire) != 0) {
+                if (store.header().magic != kMagic) {
+                    ::close(fd);
+                    throw std::system_error(EINVAL, std::generic_category(), "not a shared account store");
+                }
+                if (store.bytes_ >= segmentSize(store.header().capacity)) {
+                    ::close(fd);
+                    return store;
+                }
+            }
+            if (std::chrono::steady_clock::now() >= deadline) {
+                ::close(fd);
+                throw std::system_error(std::make_error_code(std::errc::timed_out),
+                                        "shared account store was not set up by its creator");
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+
+    // Remove the name. Processes that are attached keep their mapping until they detach.
+    static void remove(const std::string& name) noexcept {
+        ::shm_unlink(name.c_str());
+    }
+
+    SharedAccountStore(SharedAccountStore&& other) noexcept
+        : base_(std::exchange(other.base_, nullptr)), bytes_(std::exchange(other.bytes_, 0)) {}
+
+    SharedAccountStore& operator=(SharedAccountStore&& other) noexcept {
+        if (this != &other) {
+            detach();
+            base_ = std::exchange(other.base_, nullptr);
+            bytes_ = std::exchange(other.bytes_, 0);
+        }
+        return *this;
+    }
+
+    SharedAccountStore(const SharedAccountStore&) = delete;
+    SharedAccountStore& operator=(const SharedAccountStore&) = delete;
+
+    ~SharedAccountStore() {
+        detach();
+    }
+
+    // !(amount > 0.0) rather than amount <= 0.0, so NaN is rejected too: a NaN balance in the segment would reach
+    // every process attached to it.
+    void deposit(std::uint32_t account, double amount) {
+        if (!(amount > 0.0)) {
+            throw_invalid_amount("Invalid deposit amount", amount);
+        }
+        withLocked(account, [&](double& balance) { balance += amount; });
+    }
+
+    void withdraw(std::uint32_t account, double amount) {
+        if (!(amount > 0.0)) {
+            throw_invalid_amount("Invalid withdrawal amount", amount);
+        }
+        withLocked(account, [&](double& balance) {
+            if (amount > balance) {
+                throw_insufficient_funds(amount, balance);
+            }
+            balance -= amount;
+        });
+    }
+
+    double getBalance(std::uint32_t account) {
+        double result = 0.0;
+        withLocked(account, [&](double& balance) { result = balance; });
+        return result;
+    }
+
+    AccountStatus tryDeposit(std::uint32_t account, double amount) {
+        if (account >= capacity()) {
+            return AccountStatus::UnknownAccount;
+        }
+        if (!(amount > 0.0)) {
+            return AccountStatus::InvalidAmount;
+        }
+        withLocked(account, [&](double& balance) { balance += amount; });
+        return AccountStatus::Ok;
+    }
+
+    AccountStatus tryWithdraw(std::uint32_t account, double amount) {
+        if (account >= capacity()) {
+            return AccountStatus::UnknownAccount;
+        }
+        if (!(amount > 0.0)) {
+            return AccountStatus::InvalidAmount;
+        }
+        AccountStatus status = AccountStatus::Ok;
+        withLocked(account, [&](double& balance) {
+            if (amount > balance) {
+                status = AccountStatus::InsufficientFunds;
+            } else {
+                balance -= amount;
+            }
+        });
+        return status;
+    }
+
+    // Run f(balance) while holding the account's lock, for operations that need more than one step.
+    // f should leave the balance valid after every store: if the process dies inside f, others continue with it.
+    template <typename F>
+    void withLocked(std::uint32_t account, F&& f) {
+        if (account >= capacity()) {
+            throw_unknown_account(account);
+        }
+        pthread_mutex_t& mutex = header().stripes[account % kStripes];
+        const int result = ::pthread_mutex_lock(&mutex);
+        if (result == EOWNERDEAD) {
+            // The previous holder crashed. Our balances are always consistent, so just take over.
+            ::pthread_mutex_consistent(&mutex);
+            header().recoveredLocks.fetch_add(1, std::memory_order_relaxed);
+        } else if (result != 0) {
+            throw std::system_error(result, std::generic_category(), "pthread_mutex_lock");
+        }
+        struct Unlock {
+            pthread_mutex_t& mutex;
+            ~Unlock() { ::pthread_mutex_unlock(&mutex); }
+        } unlock{mutex};
+        f(balances()[account]);
+    }
+
+    std::uint32_t capacity() const noexcept { return header().capacity; }
+
+    // How many times a lock was taken over from a process that died holding it.
+    std::uint64_t recoveredLocks() const noexcept {
+        return header().recoveredLocks.load(std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr std::uint64_t kMagic = 0x45484143434f554eull; // "EHACCOUN"
+
+    struct Header {
+        std::uint64_t magic;
+        std::uint32_t capacity;
+        std::atomic<std::uint32_t> ready;
+        std::atomic<std::uint64_t> recoveredLocks;
+        pthread_mutex_t stripes[kStripes];
+    };
+
+    static_assert(std::atomic<std::uint32_t>::is_always_lock_free, "atomics in shared memory must be lock-free");
+    static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "atomics in shared memory must be lock-free");
+
+    static std::size_t balancesOffset() noexcept {
+        return (sizeof(Header) + alignof(double) - 1) / alignof(double) * alignof(double);
+    }
+
+    static std::size_t segmentSize(std::uint32_t capacity) noexcept {
+        return balancesOffset() + std::size_t{capacity} * sizeof(double);
+    }
+
+    [[noreturn]] static void throwSystemError(const char* what) {
+        throw std::system_error(errno, std::generic_category(), what);
+    }
+
+    SharedAccountStore(void* base, std::size_t bytes) noexcept : base_(base), bytes_(bytes) {}
+
+    // Map the segment; on failure close fd and throw.
+    static void* mapOrClose(int fd, std::size_t bytes) {
+        void* mapping = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (mapping == MAP_FAILED) {
+            const int error = errno;
+            ::close(fd);
+            throw std::system_error(error, std::generic_category(), "mmap");
+        }
+        return mapping;
+    }
+
+    void initialize(std::uint32_t capacity) {
+        Header& h = header();
+        h.magic = kMagic;
+        h.capacity = capacity;
+        h.recoveredLocks.store(0, std::memory_order_relaxed);
+
+        pthread_mutexattr_t attributes;
+        ::pthread_mutexattr_init(&attributes);
+        ::pthread_mutexattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED);
+        ::pthread_mutexattr_setrobust(&attributes, PTHREAD_MUTEX_ROBUST);
+        for (auto& stripe : h.stripes) {
+            ::pthread_mutex_init(&stripe, &attributes);
+        }
+        ::pthread_mutexattr_destroy(&attributes);
+        // ftruncate already filled the balances with zero bytes, which is 0.0.
+
+        h.ready.store(1, std::memory_order_release);
+    }
+
+    void detach() noexcept {
+        if (base_ != nullptr) {
+            ::munmap(base_, bytes_);
+            base_ = nullptr;
+        }
+    }
+
+    Header& header() const noexcept { return *static_cast<Header*>(base_); }
+
+    double* balances() const noexcept {
+        return reinterpret_cast<double*>(static_cast<char*>(base_) + balancesOffset());
+    }
+
+    void* base_ = nullptr;
+    std::size_t bytes_ = 0;
+};
+
+#endif //EXCEPTIONHANDLING_SHARED_ACCOUNT_STORE_H
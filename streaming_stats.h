@@ -0,0 +1,274 @@
+#ifndef EXCEPTIONHANDLING_STREAMING_STATS_H
+#define EXCEPTIONHANDLING_STREAMING_STATS_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "throw_helpers.h"
+
+// Streaming statistics: calculate_avg() only gives us the mean of numbers we already have.
+// StreamingStats looks at every value once, keeps a constant amount of memory and can still answer
+// mean, variance, min, max and approximate quantiles (p50, p99, ...) over an unbounded stream.
+//
+// Two accumulators from two different sketches can be merged, so every thread (or every server)
+// can collect its own statistics and combine them afterwards.
+//
+// Errors are reported with the same exceptions the rest of the project uses:
+//  - asking for a statistic of an empty stream throws DivideByZeroException (the mean of 0 values is a division by zero),
+//  - NaN / infinite input or a quantile outside [0, 1] throws std::invalid_argument.
+
+
+// KLL quantile sketch (Karnin, Lang, Liberty 2016).
+// Values are kept in "compactors" (levels). Every value on level h stands for 2^h values of the stream.
+// When a level is full it is sorted and every second value is promoted to the next level,
+// which halves the memory and doubles the weight of the promoted values.
+// Lower levels get geometrically smaller capacities, so the total memory stays O(k) no matter how many values we insert.
+class KllSketch {
+public:
+    explicit KllSketch(std::size_t k = 200) : k_(std::max<std::size_t>(k, 8)) {
+        levels_.emplace_back();
+        levels_[0].reserve(k_);
+        updateMaxSize();
+    }
+
+    void insert(double value) {
+        levels_[0].push_back(value);
+        ++n_;
+        if (++size_ >= maxSize_) {
+            compress();
+        }
+    }
+
+    // Combine the values of another sketch into this one.
+    void merge(const KllSketch& other) {
+        while (levels_.size() < other.levels_.size()) {
+            levels_.emplace_back();
+        }
+        for (std::size_t h = 0; h < other.levels_.size(); ++h) {
+            auto& level = levels_[h];
+            const auto oldSize = static_cast<std::ptrdiff_t>(level.size());
+            level.insert(level.end(), other.levels_[h].begin(), other.levels_[h].end());
+            if (h > 0) {
+                std::inplace_merge(level.begin(), level.begin() + oldSize, level.end());
+            }
+        }
+        size_ += other.size_;
+        n_ += other.n_;
+        updateMaxSize();
+        while (size_ >= maxSize_) {
+            compress();
+        }
+    }
+
+    // Approximate value below which a fraction q of the stream lies.
+    double quantile(double q) const {
+        if (!(q >= 0.0 && q <= 1.0)) {
+            throw_invalid_argument("Quantile must be in [0, 1]");
+        }
+        if (n_ == 0) {
+            throw_divide_by_zero();
+        }
+
+        std::vector<std::pair<double, std::uint64_t>> weighted;
+        weighted.reserve(size_);
+        for (std::size_t h = 0; h < levels_.size(); ++h) {
+            for (double value : levels_[h]) {
+                weighted.emplace_back(value, std::uint64_t{1} << h);
+            }
+        }
+        std::sort(weighted.begin(), weighted.end(),
+                  [](const auto& a, const auto& b) { return a.first < b.first; });
+
+        std::uint64_t total = 0;
+        for (const auto& item : weighted) {
+            total += item.second;
+        }
+        const auto rank = static_cast<std::uint64_t>(q * static_cast<double>(total));
+        std::uint64_t seen = 0;
+        for (const auto& item : weighted) {
+            seen += item.second;
+            if (seen > rank) {
+                return item.first;
+            }
+        }
+        return weighted.back().first;
+    }
+
+    std::uint64_t count() const noexcept { return n_; }
+
+    // Number of values currently kept in memory.
+    std::size_t retained() const noexcept { return size_; }
+
+private:
+    // Capacity of level h: k on the top level, shrinking by 2/3 for every level below it.
+    std::size_t computeCapacity(std::size_t level) const {
+        const auto depth = static_cast<double>(levels_.size() - level - 1);
+        const auto cap = static_cast<std::size_t>(std::ceil(static_cast<double>(k_) * std::pow(2.0 / 3.0, depth)));
+        return std::max<std::size_t>(cap, 8);
+    }
+
+    // Capacities only change when a level is added, so they are computed once and cached.
+    void updateMaxSize() {
+        capacities_.resize(levels_.size());
+        maxSize_ = 0;
+        for (std::size_t h = 0; h < levels_.size(); ++h) {
+            capacities_[h] = computeCapacity(h);
+            maxSize_ += capacities_[h];
+        }
+    }
+
+    // Merge a sorted run into a sorted level. The scratch buffers are members, so after warm-up
+    // the compactions do not allocate (std::inplace_merge would grab a temporary buffer every time).
+    void mergeSorted(std::vector<double>& level, const std::vector<double>& run) {
+        merged_.resize(level.size() + run.size());
+        std::merge(level.begin(), level.end(), run.begin(), run.end(), merged_.begin());
+        level.swap(merged_);
+    }
+
+    // Compact the lowest level that is over its capacity.
+    void compress() {
+        for (std::size_t h = 0; h < levels_.size(); ++h) {
+            if (levels_[h].size() < capacities_[h]) {
+                continue;
+            }
+            if (h + 1 == levels_.size()) {
+                levels_.emplace_back();
+                updateMaxSize();
+            }
+
+            // Only level 0 is unsorted. Every higher level is kept sorted, because what it receives is
+            // already sorted: merging the promoted run in is linear, a full sort would be n log n.
+            auto& level = levels_[h];
+            auto& next = levels_[h + 1];
+            if (h == 0) {
+                std::sort(level.begin(), level.end());
+            }
+
+            // With an odd number of values one stays behind, so the weights keep adding up.
+            const bool odd = level.size() % 2 != 0;
+            const std::size_t begin = odd ? 1 : 0;
+
+            // A random offset keeps the error unbiased (we promote either the even or the odd positions).
+            rng_ ^= rng_ << 13;
+            rng_ ^= rng_ >> 7;
+            rng_ ^= rng_ << 17;
+            const std::size_t offset = rng_ & 1;
+
+            promoted_.clear();
+            for (std::size_t i = begin + offset; i < level.size(); i += 2) {
+                promoted_.push_back(level[i]);
+            }
+            mergeSorted(next, promoted_);
+            size_ -= (level.size() - begin) - promoted_.size();
+            level.resize(begin);
+            return;
+        }
+    }
+
+    std::size_t k_;
+    std::vector<std::vector<double>> levels_;
+    std::vector<std::size_t> capacities_;
+    std::vector<double> promoted_;
+    std::vector<double> merged_;
+    std::size_t size_ = 0;
+    std::size_t maxSize_ = 0;
+    std::uint64_t n_ = 0;
+    std::uint64_t rng_ = 0x9E3779B97F4A7C15ull;
+};
+
+
+// Mean and variance use Welford's online algorithm, which stays numerically stable
+// even when the values are large and close together (the naive sum of squares does not).
+class StreamingStats {
+public:
+    explicit StreamingStats(std::size_t sketchK = 200) : sketch_(sketchK) {}
+
+    void insert(double value) {
+        if (!std::isfinite(value)) {
+            throw_invalid_argument("Statistics input must be a finite number");
+        }
+        ++count_;
+        const double delta = value - mean_;
+        mean_ += delta / static_cast<double>(count_);
+        m2_ += delta * (value - mean_);
+        min_ = std::min(min_, value);
+        max_ = std::max(max_, value);
+        sketch_.insert(value);
+    }
+
+    // Combine two accumulators (Chan et al. parallel variance formula).
+    void merge(const StreamingStats& other) {
+        if (other.count_ == 0) {
+            return;
+        }
+        const auto n = static_cast<double>(count_ + other.count_);
+        const double delta = other.mean_ - mean_;
+        mean_ += delta * static_cast<double>(other.count_) / n;
+        m2_ += other.m2_ + delta * delta * static_cast<double>(count_) * static_cast<double>(other.count_) / n;
+        count_ += other.count_;
+        min_ = std::min(min_, other.min_);
+        max_ = std::max(max_, other.max_);
+        sketch_.merge(other.sketch_);
+    }
+
+    std::uint64_t count() const noexcept { return count_; }
+
+    double mean() const {
+        requireValues(1);
+        return mean_;
+    }
+
+    // Population variance of all values seen so far.
+    double variance() const {
+        requireValues(1);
+        return m2_ / static_cast<double>(count_);
+    }
+
+    // Sample variance, needs at least two values (divides by n - 1).
+    double sampleVariance() const {
+        requireValues(2);
+        return m2_ / static_cast<double>(count_ - 1);
+    }
+
+    double stddev() const {
+        return std::sqrt(variance());
+    }
+
+    double min() const {
+        requireValues(1);
+        return min_;
+    }
+
+    double max() const {
+        requireValues(1);
+        return max_;
+    }
+
+    double quantile(double q) const {
+        return sketch_.quantile(q);
+    }
+
+    double p50() const { return quantile(0.50); }
+    double p99() const { return quantile(0.99); }
+
+private:
+    void requireValues(std::uint64_t needed) const {
+        if (count_ < needed) {
+            throw_divide_by_zero();
+        }
+    }
+
+    std::uint64_t count_ = 0;
+    double mean_ = 0.0;
+    double m2_ = 0.0;
+    double min_ = std::numeric_limits<double>::infinity();
+    double max_ = -std::numeric_limits<double>::infinity();
+    KllSketch sketch_;
+};
+
+#endif //EXCEPTIONHANDLING_STREAMING_STATS_H
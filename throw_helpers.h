@@ -0,0 +1,77 @@
+#ifndef EXCEPTIONHANDLING_THROW_HELPERS_H
+#define EXCEPTIONHANDLING_THROW_HELPERS_H
+
+#include <stdexcept>
+
+#include "breadcrumbs.h"
+#include "exceptions.h"
+
+// Cold throw helpers.
+// A throw expression is more code than it looks: allocate the exception, construct it (often a std::string),
+// register the destructor and call the runtime. When it is written inside a small hot function, all of that
+// sits between the instructions we actually run on every call and takes space in the instruction cache.
+//
+// Every project throw site calls one of the helpers below instead. They are
+//  - [[noreturn]], so the compiler knows the caller does not continue after the call,
+//  - noinline, so the throwing code is emitted once instead of in every caller,
+//  - cold, so GCC/Clang move them (and the branch that leads to them) out of the hot code path.
+// The hot function is left with a compare and a call.
+//
+// Because every project exception passes through here, the helpers are also where the thread's breadcrumbs
+// are saved for the handler (breadcrumbs.h).
+
+#if defined(__GNUC__) || defined(__clang__)
+#define EH_COLD_THROW [[noreturn]] __attribute__((cold, noinline))
+#elif defined(_MSC_VER)
+#define EH_COLD_THROW [[noreturn]] __declspec(noinline)
+#else
+#define EH_COLD_THROW [[noreturn]]
+#endif
+
+EH_COLD_THROW inline void throw_divide_by_zero() {
+    snapshot_breadcrumbs_for_exception();
+    throw DivideByZeroException();
+}
+
+EH_COLD_THROW inline void throw_negative_value() {
+    snapshot_breadcrumbs_for_exception();
+    throw NegativeValueException();
+}
+
+EH_COLD_THROW inline void throw_invalid_argument(const char* message) {
+    snapshot_breadcrumbs_for_exception();
+    throw InvalidArgumentException(message);
+}
+
+EH_COLD_THROW inline void throw_invalid_amount(const char* message, double amount) {
+    snapshot_breadcrumbs_for_exception();
+    throw InvalidAmountException(message, amount);
+}
+
+EH_COLD_THROW inline void throw_insufficient_funds(double amount, double balance) {
+    snapshot_breadcrumbs_for_exception();
+    throw InsufficientFundsException(amount, balance);
+}
+
+EH_COLD_THROW inline void throw_unknown_account(unsigned long long accountId) {
+    snapshot_breadcrumbs_for_exception();
+    throw UnknownAccountException(accountId);
+}
+
+EH_COLD_THROW inline void throw_withdrawal_limit(double amount, double remaining) {
+    snapshot_breadcrumbs_for_exception();
+    throw WithdrawalLimitException(amount, remaining);
+}
+
+EH_COLD_THROW inline void throw_velocity_limit(double amount, unsigned withdrawals, double withdrawn) {
+    snapshot_breadcrumbs_for_exception();
+    throw VelocityLimitException(amount, withdrawals, withdrawn);
+}
+
+// Failed invariant check (contracts.h, audit level), or an object used in a way it does not allow.
+EH_COLD_THROW inline void throw_contract_violation(const char* message) {
+    snapshot_breadcrumbs_for_exception();
+    throw ContractViolationException(message);
+}
+
+#endif //EXCEPTIONHANDLING_THROW_HELPERS_H
@@ -0,0 +1,314 @@
+#ifndef EXCEPTIONHANDLING_TIMER_WHEEL_H
+#define EXCEPTIONHANDLING_TIMER_WHEEL_H
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "bank_account.h"
+#include "throw_helpers.h"
+
+// Scheduled deposits and withdrawals (standing orders, delayed settlements) in a hierarchical timing wheel.
+//
+// Time is counted in ticks; the caller decides what a tick is (a millisecond, a second, a settlement cycle)
+// and moves time forward with advance(). The wheel has 4 levels of 256 slots:
+//   level 0: one slot per tick for the next 256 ticks
+//   level 1: one slot per 256 ticks for the next 2^16 ticks
+//   level 2: one slot per 2^16 ticks for the next 2^24 ticks
+//   level 3: one slot per 2^24 ticks for the next 2^32 ticks (timers even further away wait in the last slot)
+// A timer goes into the slot of the lowest level that reaches its due tick. When time reaches the start of a
+// higher-level slot, its timers move ("cascade") one or more levels down, until they are in level 0 on their tick.
+// Every timer within the 2^32 ticks moves down at most 3 times. Ticks without timers are skipped with a bitmap
+// of the occupied level-0 slots, so advancing over a quiet period costs little per tick.
+//
+// schedule(), cancel() and firing one timer are O(1) (schedule amortized). A timer is an entry in a pool, and a slot
+// is a vector of entry indices. cancel() only marks the entry; it leaves its slot, and goes back to the pool, when
+// time reaches that slot. With millions of timers the entries are mostly not in the cache. A linked list per slot
+// would make every step wait for the previous cache miss; walking an index vector lets the next entries
+// be prefetched while the current one is processed.
+//
+// The operations run with tryDeposit()/tryWithdraw() and do not throw. All timers due on the same tick are one
+// batch, and advance() hands each batch to a callback together with the failures in it: one report per tick,
+// not one exception per failed standing order. Recurring timers are scheduled again whether they failed or not.
+//
+// The callback may schedule() and cancel() timers; a timer it schedules for the tick being fired (or earlier) fires on
+// the next tick. It must not call advance(). The accounts must outlive their timers. Not thread-safe.
+
+enum class ScheduledOp : std::uint8_t {
+    Deposit = 1,
+    Withdraw = 2,
+};
+
+// Handle for cancel(). The generation makes a handle of a fired or cancelled timer harmless
+// even after its pool entry has been reused.
+struct TimerId {
+    std::uint32_t index;
+    std::uint32_t generation;
+};
+
+struct ScheduledFailure {
+    TimerId id;
+    BankAccount* account;
+    double amount;
+    ScheduledOp op;
+    AccountStatus status;
+};
+
+// Timers fired on one tick.
+struct FiredBatch {
+    std::uint64_t tick = 0;
+    std::size_t fired = 0;
+    std::size_t succeeded = 0;
+    std::vector<ScheduledFailure> failures;
+};
+
+class TimerWheel {
+public:
+    explicit TimerWheel(std::uint64_t startTick = 0) : now_(startTick) {}
+
+    // Run op(amount) on the account at dueTick, and then every periodTicks ticks if periodTicks is not 0.
+    // A dueTick in the past fires on the next advance().
+    TimerId schedule(std::uint64_t dueTick, BankAccount& account, ScheduledOp op, double amount,
+                     std::uint32_t periodTicks = 0) {
+        // From the callback of advance(), the slot of now_ has been taken already: the earliest is the next tick.
+        const std::uint64_t earliest = inCallback_ ? now_ + 1 : now_;
+        std::uint32_t index;
+        if (free_ != kNone) {
+            index = free_;
+            free_ = entries_[index].next;
+        } else {
+            index = static_cast<std::uint32_t>(entries_.size());
+            entries_.emplace_back();
+        }
+        Entry& entry = entries_[index];
+        entry.due = dueTick < earliest ? earliest : dueTick;
+        entry.account = &account;
+        entry.amount = amount;
+        entry.period = periodTicks;
+        entry.op = op;
+        entry.state = State::Scheduled;
+        insert(index);
+        ++pending_;
+        return TimerId{index, entry.generation};
+    }
+
+    // Returns false if the timer has fired (and was not recurring) or was cancelled already.
+    bool cancel(TimerId id) noexcept {
+        if (id.index >= entries_.size()) {
+            return false;
+        }
+        Entry& entry = entries_[id.index];
+        if (entry.state != State::Scheduled || entry.generation != id.generation) {
+            return false;
+        }
+        entry.state = State::Cancelled;
+        ++entry.generation;
+        --pending_;
+        return true;
+    }
+
+    // Move time forward to tick (inclusive) and fire everything due on the way.
+    // onBatch(const FiredBatch&) is called once per tick that fired at least one timer.
+    template <typename OnBatch>
+    void advance(std::uint64_t tick, OnBatch&& onBatch) {
+        if (inCallback_) {
+            throw_contract_violation("TimerWheel::advance() called from its own callback");
+        }
+        while (now_ <= tick) {
+            if (pending_ == 0) {
+                now_ = tick + 1;   // cancelled entries are released when time reaches their slots later
+                return;
+            }
+            cascade();
+            fire(onBatch);
+            ++now_;
+            skipEmptyTicks(tick);
+        }
+    }
+
+    // Next tick advance() will process.
+    std::uint64_t now() const noexcept { return now_; }
+    // Scheduled timers, not counting cancelled ones.
+    std::size_t pending() const noexcept { return pending_; }
+
+    void reserve(std::size_t timers) { entries_.reserve(timers); }
+
+private:
+    static constexpr unsigned kLevels = 4;
+    static constexpr unsigned kSlotBits = 8;
+    static constexpr unsigned kSlots = 1u << kSlotBits;
+    static constexpr std::uint32_t kNone = ~std::uint32_t{0};
+    static constexpr std::uint64_t kHorizon = std::uint64_t{1} << (kLevels * kSlotBits);
+    static constexpr std::size_t kPrefetchDistance = 8;
+
+    enum class State : std::uint8_t {
+        Free,
+        Scheduled,
+        Cancelled,   // still in its slot until time gets there
+    };
+
+    struct Entry {
+        std::uint64_t due = 0;
+        BankAccount* account = nullptr;
+        double amount = 0.0;
+        std::uint32_t period = 0;
+        std::uint32_t next = kNone;   // next in the free list
+        std::uint32_t generation = 0;
+        ScheduledOp op = ScheduledOp::Deposit;
+        State state = State::Free;
+    };
+
+    // Add the entry to the slot for its due tick, as seen from now_.
+    void insert(std::uint32_t index) {
+        Entry& entry = entries_[index];
+        std::uint64_t delta = entry.due - now_;
+        if (delta >= kHorizon) {
+            delta = kHorizon - 1;   // cascades down again when that slot is reached
+        }
+        unsigned level = 0;
+        while (level + 1 < kLevels && delta >= (std::uint64_t{1} << ((level + 1) * kSlotBits))) {
+            ++level;
+        }
+        const std::uint64_t position = now_ + delta;
+        const unsigned slot = level * kSlots + static_cast<unsigned>((position >> (level * kSlotBits)) & (kSlots - 1));
+        slots_[slot].push_back(index);
+        if (slot < kSlots) {
+            occupied_[slot / 64] |= std::uint64_t{1} << (slot % 64);
+        }
+    }
+
+    void release(std::uint32_t index) noexcept {
+        Entry& entry = entries_[index];
+        entry.state = State::Free;
+        entry.next = free_;
+        free_ = index;
+    }
+
+    // Move the indices of a slot into taken_; its entries are inserted somewhere else (possibly into the same
+    // slot again), fired or released. The slot keeps the old buffer of taken_, so no vector allocates again.
+    void takeSlot(unsigned slot) noexcept {
+        taken_.clear();
+        taken_.swap(slots_[slot]);
+        if (slot < kSlots) {
+            occupied_[slot / 64] &= ~(std::uint64_t{1} << (slot % 64));
+        }
+    }
+
+    // Prefetch the entry kPrefetchDistance ahead, and the account of the one half as far ahead
+    // (its entry has been prefetched by then).
+    void prefetchAhead(std::size_t i) const noexcept {
+        if (i + kPrefetchDistance < taken_.size()) {
+            __builtin_prefetch(&entries_[taken_[i + kPrefetchDistance]]);
+        }
+        if (i + kPrefetchDistance / 2 < taken_.size()) {
+            __builtin_prefetch(entries_[taken_[i + kPrefetchDistance / 2]].account);
+        }
+    }
+
+    // At the start of a level-L slot's time range, move its timers down. Highest level first, so timers
+    // that cascade from level 3 to level 2 on this tick are cascaded again by the level 2 step.
+    void cascade() {
+        for (unsigned level = kLevels - 1; level > 0; --level) {
+            if ((now_ & ((std::uint64_t{1} << (level * kSlotBits)) - 1)) != 0) {
+                continue;
+            }
+            const unsigned slot = level * kSlots + static_cast<unsigned>((now_ >> (level * kSlotBits)) & (kSlots - 1));
+            takeSlot(slot);
+            for (std::size_t i = 0; i < taken_.size(); ++i) {
+                if (i + kPrefetchDistance < taken_.size()) {
+                    __builtin_prefetch(&entries_[taken_[i + kPrefetchDistance]]);
+                }
+                const std::uint32_t index = taken_[i];
+                if (entries_[index].state == State::Cancelled) {
+                    release(index);
+                } else {
+                    insert(index);
+                }
+            }
+        }
+    }
+
+    // Jump over ticks with an empty level-0 slot, using the occupancy bits of level 0, but stop at the next
+    // multiple of 256 (a cascade may fill level 0 there) and after tick.
+    void skipEmptyTicks(std::uint64_t tick) noexcept {
+        if ((now_ & (kSlots - 1)) == 0) {
+            return;
+        }
+        const std::uint64_t windowStart = now_ & ~std::uint64_t{kSlots - 1};
+        std::uint64_t next = windowStart + kSlots;
+        for (unsigned word = static_cast<unsigned>((now_ & (kSlots - 1)) / 64); word < kSlots / 64; ++word) {
+            std::uint64_t bits = occupied_[word];
+            if (word == (now_ & (kSlots - 1)) / 64) {
+                bits &= ~std::uint64_t{0} << (now_ % 64);
+            }
+            if (bits != 0) {
+                next = windowStart + word * 64 + static_cast<unsigned>(std::countr_zero(bits));
+                break;
+            }
+        }
+        now_ = next < tick + 1 ? next : tick + 1;
+    }
+
+    // All due entries are processed (rescheduled or released) before onBatch runs, and no Entry& is held across
+    // the call: a schedule() from the callback may reallocate entries_ and the slot vectors.
+    template <typename OnBatch>
+    void fire(OnBatch& onBatch) {
+        takeSlot(static_cast<unsigned>(now_ & (kSlots - 1)));
+        if (taken_.empty()) {
+            return;
+        }
+        batch_.tick = now_;
+        batch_.fired = 0;
+        batch_.succeeded = 0;
+        batch_.failures.clear();
+        for (std::size_t i = 0; i < taken_.size(); ++i) {
+            prefetchAhead(i);
+            const std::uint32_t index = taken_[i];
+            Entry& entry = entries_[index];
+            if (entry.state == State::Cancelled) {
+                release(index);
+                continue;
+            }
+            const AccountStatus status = entry.op == ScheduledOp::Deposit ? entry.account->tryDeposit(entry.amount)
+                                                                          : entry.account->tryWithdraw(entry.amount);
+            ++batch_.fired;
+            if (status == AccountStatus::Ok) {
+                ++batch_.succeeded;
+            } else {
+                batch_.failures.push_back(
+                    {TimerId{index, entry.generation}, entry.account, entry.amount, entry.op, status});
+            }
+            if (entry.period != 0) {
+                entry.due = now_ + entry.period;
+                insert(index);
+            } else {
+                ++entry.generation;
+                --pending_;
+                release(index);
+            }
+        }
+        if (batch_.fired != 0) {
+            inCallback_ = true;
+            try {
+                onBatch(static_cast<const FiredBatch&>(batch_));
+            } catch (...) {
+                inCallback_ = false;
+                throw;
+            }
+            inCallback_ = false;
+        }
+    }
+
+    std::vector<Entry> entries_;
+    std::vector<std::uint32_t> slots_[kLevels * kSlots];
+    std::vector<std::uint32_t> taken_;
+    std::uint64_t occupied_[kSlots / 64] = {};   // level-0 slots that are not empty
+    std::uint32_t free_ = kNone;
+    std::size_t pending_ = 0;
+    std::uint64_t now_;
+    FiredBatch batch_;
+    bool inCallback_ = false;
+};
+
+#endif //EXCEPTIONHANDLING_TIMER_WHEEL_H
@@ -0,0 +1,203 @@
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "account_protocol.h"
+
+// Load tester for AccountServer. Every connection runs in its own thread and keeps a fixed number of requests
+// in flight: it sends a batch of `depth` requests with one write, reads the `depth` replies and sends the next batch.
+// The latency of a request is the time from writing its batch to reading its reply.
+//
+// The accounts 1 .. accounts are opened first with a balance of 1000. The mix is 45% deposit, 45% withdraw and
+// 10% getBalance of random accounts, with amounts that sometimes fail, so error replies are part of the load.
+//
+// Usage: AccountLoadTest [socket path] [connections, default 4] [requests, default 2000000]
+//                        [pipeline depth, default 32] [accounts, default 10000]
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    const char* path = "/tmp/exception_handling_accounts.sock";
+    unsigned connections = 4;
+    std::uint64_t requests = 2'000'000;
+    unsigned depth = 32;
+    std::uint64_t accounts = 10'000;
+};
+
+struct Result {
+    std::vector<float> latenciesUs;
+    std::uint64_t byStatus[256] = {};
+    bool failed = false;
+};
+
+int connectTo(const char* path) {
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, path, sizeof address.sun_path - 1);
+    if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof address) != 0) {
+        std::perror(path);
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        return -1;
+    }
+    return fd;
+}
+
+bool writeAll(int fd, const char* data, std::size_t size) {
+    while (size > 0) {
+        const ssize_t n = ::write(fd, data, size);
+        if (n <= 0) {
+            return false;
+        }
+        data += n;
+        size -= static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+bool readAll(int fd, char* data, std::size_t size) {
+    while (size > 0) {
+        const ssize_t n = ::read(fd, data, size);
+        if (n <= 0) {
+            return false;
+        }
+        data += n;
+        size -= static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+// Send the requests in batches of `depth` and check that the replies come back in order.
+template <typename MakeRequest>
+bool exchange(int fd, std::uint64_t count, unsigned depth, MakeRequest makeNext, Result* result) {
+    std::vector<char> requests(depth * sizeof(Request));
+    std::vector<char> replies(depth * sizeof(Reply));
+    for (std::uint64_t sent = 0; sent < count;) {
+        const auto batch = static_cast<unsigned>(std::min<std::uint64_t>(depth, count - sent));
+        for (unsigned i = 0; i < batch; ++i) {
+            storeRecord(requests.data() + i * sizeof(Request), makeNext(sent + i));
+        }
+        const Clock::time_point start = Clock::now();
+        if (!writeAll(fd, requests.data(), batch * sizeof(Request)) ||
+            !readAll(fd, replies.data(), batch * sizeof(Reply))) {
+            return false;
+        }
+        const float us = std::chrono::duration<float, std::micro>(Clock::now() - start).count();
+        for (unsigned i = 0; i < batch; ++i) {
+            const Reply reply = loadRecord<Reply>(replies.data() + i * sizeof(Reply));
+            if (reply.requestId != sent + i) {
+                std::fprintf(stderr, "reply %llu out of order\n", static_cast<unsigned long long>(reply.requestId));
+                return false;
+            }
+            if (result != nullptr) {
+                result->latenciesUs.push_back(us);
+                ++result->byStatus[static_cast<std::uint8_t>(reply.status)];
+            }
+        }
+        sent += batch;
+    }
+    return true;
+}
+
+bool openAccounts(const Options& options) {
+    const int fd = connectTo(options.path);
+    if (fd < 0) {
+        return false;
+    }
+    const bool ok = exchange(fd, options.accounts, 256, [](std::uint64_t i) {
+        return makeRequest(Opcode::Open, i, i + 1, 1000.0);
+    }, nullptr);
+    ::close(fd);
+    return ok;
+}
+
+void runConnection(const Options& options, unsigned index, std::uint64_t requests, Result& result) {
+    const int fd = connectTo(options.path);
+    if (fd < 0) {
+        result.failed = true;
+        return;
+    }
+    result.latenciesUs.reserve(requests);
+    std::mt19937_64 rng(index + 1);
+    const auto next = [&](std::uint64_t i) {
+        const std::uint64_t account = rng() % options.accounts + 1;
+        const double amount = static_cast<double>(rng() % 100);   // 0 is an InvalidAmount
+        const unsigned pick = static_cast<unsigned>(rng() % 20);
+        const Opcode opcode = pick < 9 ? Opcode::Deposit : pick < 18 ? Opcode::Withdraw : Opcode::GetBalance;
+        return makeRequest(opcode, i, account, amount);
+    };
+    result.failed = !exchange(fd, requests, options.depth, next, &result);
+    ::close(fd);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (argc > 1) options.path = argv[1];
+    if (argc > 2) options.connections = static_cast<unsigned>(std::strtoul(argv[2], nullptr, 10));
+    if (argc > 3) options.requests = std::strtoull(argv[3], nullptr, 10);
+    if (argc > 4) options.depth = static_cast<unsigned>(std::strtoul(argv[4], nullptr, 10));
+    if (argc > 5) options.accounts = std::strtoull(argv[5], nullptr, 10);
+    options.connections = std::max(options.connections, 1u);
+    options.depth = std::max(options.depth, 1u);
+
+    if (!openAccounts(options)) {
+        return 1;
+    }
+
+    std::vector<Result> results(options.connections);
+    std::vector<std::thread> threads;
+    const Clock::time_point start = Clock::now();
+    for (unsigned c = 0; c < options.connections; ++c) {
+        threads.emplace_back(runConnection, std::cref(options), c, options.requests / options.connections,
+                             std::ref(results[c]));
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::vector<float> latencies;
+    std::uint64_t byStatus[256] = {};
+    for (const Result& result : results) {
+        if (result.failed) {
+            std::fprintf(stderr, "a connection failed\n");
+            return 1;
+        }
+        latencies.insert(latencies.end(), result.latenciesUs.begin(), result.latenciesUs.end());
+        for (int s = 0; s < 256; ++s) {
+            byStatus[s] += result.byStatus[s];
+        }
+    }
+    std::sort(latencies.begin(), latencies.end());
+    const auto at = [&](double q) {
+        return latencies[std::min(latencies.size() - 1, static_cast<std::size_t>(q * static_cast<double>(latencies.size())))];
+    };
+
+    std::printf("%u connections, pipeline depth %u, %zu requests in %.2f s\n", options.connections, options.depth,
+                latencies.size(), seconds);
+    std::printf("%.0f requests/s\n", static_cast<double>(latencies.size()) / seconds);
+    std::printf("latency us: p50 %.1f  p99 %.1f  p99.9 %.1f  max %.1f\n", at(0.5), at(0.99), at(0.999),
+                latencies.back());
+    for (int s = 0; s < 256; ++s) {
+        if (byStatus[s] != 0) {
+            std::printf("  %-18s %llu\n", replyStatusName(static_cast<ReplyStatus>(s)),
+                        static_cast<unsigned long long>(byStatus[s]));
+        }
+    }
+    return 0;
+}
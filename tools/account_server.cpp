@@ -0,0 +1,251 @@
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "account_protocol.h"
+#include "account_registry.h"
+
+// Account service for other local processes: an AccountRegistry behind a Unix domain socket.
+// See account_protocol.h for the protocol.
+//
+// One thread, one epoll instance, non-blocking sockets. For every readable connection the server reads up to 64 KB,
+// answers every complete request in it, in order, into one output buffer and sends that with one write
+// (pipelined requests are batched automatically). Replies that do not fit into the socket are kept and sent
+// when epoll reports the socket writable again; meanwhile the connection's requests are not read,
+// so a client that never reads cannot make the server buffer without limit.
+//
+// Usage: AccountServer [socket path, default /tmp/exception_handling_accounts.sock]
+
+namespace {
+
+volatile std::sig_atomic_t stopRequested = 0;
+
+void requestStop(int) {
+    stopRequested = 1;
+}
+
+struct Connection {
+    int fd;
+    std::vector<char> in;    // bytes of an incomplete request left over from the last read
+    std::vector<char> out;   // replies not written yet
+    std::size_t outSent = 0;
+    bool waitingForOut = false;   // registered for EPOLLOUT instead of EPOLLIN
+};
+
+class Server {
+public:
+    explicit Server(const char* path) : path_(path) {}
+
+    int run() {
+        if (!listen() || !watch(listener_, EPOLLIN)) {
+            return 1;
+        }
+        std::printf("listening on %s\n", path_);
+        std::fflush(stdout);
+
+        epoll_event events[64];
+        while (stopRequested == 0) {
+            const int ready = ::epoll_wait(epoll_, events, 64, -1);
+            if (ready < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                std::perror("epoll_wait");
+                break;
+            }
+            for (int i = 0; i < ready; ++i) {
+                if (events[i].data.fd == listener_) {
+                    acceptAll();
+                } else {
+                    serve(events[i].data.fd, events[i].events);
+                }
+            }
+        }
+        std::printf("stopped: %zu accounts, %llu requests\n", registry_.size(),
+                    static_cast<unsigned long long>(requests_));
+        ::close(listener_);
+        ::unlink(path_);
+        return 0;
+    }
+
+private:
+    // Read this much at once. It also limits the replies one read produces before the server writes them.
+    static constexpr std::size_t kReadChunk = 64 * 1024;
+
+    bool listen() {
+        epoll_ = ::epoll_create1(EPOLL_CLOEXEC);
+        listener_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (epoll_ < 0 || listener_ < 0) {
+            std::perror("socket");
+            return false;
+        }
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (std::strlen(path_) >= sizeof address.sun_path) {
+            std::fprintf(stderr, "socket path too long: %s\n", path_);
+            return false;
+        }
+        std::strcpy(address.sun_path, path_);
+        ::unlink(path_);
+        if (::bind(listener_, reinterpret_cast<sockaddr*>(&address), sizeof address) != 0 ||
+            ::listen(listener_, SOMAXCONN) != 0) {
+            std::perror(path_);
+            return false;
+        }
+        return true;
+    }
+
+    bool watch(int fd, std::uint32_t events, int operation = EPOLL_CTL_ADD) {
+        epoll_event event{};
+        event.events = events;
+        event.data.fd = fd;
+        if (::epoll_ctl(epoll_, operation, fd, &event) != 0) {
+            std::perror("epoll_ctl");
+            return false;
+        }
+        return true;
+    }
+
+    void acceptAll() {
+        for (;;) {
+            const int fd = ::accept4(listener_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) {
+                if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                    std::perror("accept4");
+                }
+                return;
+            }
+            if (!watch(fd, EPOLLIN)) {
+                ::close(fd);
+                continue;
+            }
+            connections_.emplace(fd, std::make_unique<Connection>(Connection{fd, {}, {}, 0, false}));
+        }
+    }
+
+    void serve(int fd, std::uint32_t events) {
+        const auto it = connections_.find(fd);
+        if (it == connections_.end()) {
+            return;
+        }
+        Connection& connection = *it->second;
+        bool open = (events & (EPOLLERR | EPOLLHUP)) == 0 || (events & EPOLLIN) != 0;
+        if (open && (events & EPOLLOUT) != 0) {
+            open = flush(connection);
+        }
+        if (open && (events & EPOLLIN) != 0 && connection.out.empty()) {
+            open = readRequests(connection) && flush(connection);
+        }
+        if (!open) {
+            ::close(fd);
+            connections_.erase(it);
+        }
+    }
+
+    // Read one chunk and append one reply per complete request to the output buffer.
+    // Epoll is level-triggered, so whatever is left in the socket is reported again after the replies went out.
+    bool readRequests(Connection& connection) {
+        char chunk[kReadChunk];
+        ssize_t n;
+        do {
+            n = ::read(connection.fd, chunk, sizeof chunk);
+        } while (n < 0 && errno == EINTR);
+        if (n == 0) {
+            return false;
+        }
+        if (n < 0) {
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        const char* data = chunk;
+        std::size_t size = static_cast<std::size_t>(n);
+        // Complete the request that was cut in half by the previous read.
+        if (!connection.in.empty()) {
+            const std::size_t missing = std::min(sizeof(Request) - connection.in.size(), size);
+            connection.in.insert(connection.in.end(), data, data + missing);
+            data += missing;
+            size -= missing;
+            if (connection.in.size() < sizeof(Request)) {
+                return true;
+            }
+            answer(connection, loadRecord<Request>(connection.in.data()));
+            connection.in.clear();
+        }
+        for (; size >= sizeof(Request); data += sizeof(Request), size -= sizeof(Request)) {
+            answer(connection, loadRecord<Request>(data));
+        }
+        connection.in.assign(data, data + size);
+        return true;
+    }
+
+    void answer(Connection& connection, const Request& request) {
+        const Reply reply = handleRequest(registry_, request);
+        const std::size_t offset = connection.out.size();
+        connection.out.resize(offset + sizeof(Reply));
+        storeRecord(connection.out.data() + offset, reply);
+        ++requests_;
+    }
+
+    // Write as much of the output buffer as the socket takes. While something is left,
+    // wait for EPOLLOUT instead of EPOLLIN.
+    bool flush(Connection& connection) {
+        while (connection.outSent < connection.out.size()) {
+            const ssize_t n = ::write(connection.fd, connection.out.data() + connection.outSent,
+                                      connection.out.size() - connection.outSent);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    if (connection.waitingForOut) {
+                        return true;
+                    }
+                    connection.waitingForOut = true;
+                    return watch(connection.fd, EPOLLOUT, EPOLL_CTL_MOD);
+                }
+                return false;
+            }
+            connection.outSent += static_cast<std::size_t>(n);
+        }
+        connection.out.clear();
+        connection.outSent = 0;
+        if (!connection.waitingForOut) {
+            return true;
+        }
+        connection.waitingForOut = false;
+        return watch(connection.fd, EPOLLIN, EPOLL_CTL_MOD);
+    }
+
+    const char* path_;
+    int epoll_ = -1;
+    int listener_ = -1;
+    AccountRegistry registry_;
+    std::unordered_map<int, std::unique_ptr<Connection>> connections_;
+    std::uint64_t requests_ = 0;
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const char* path = argc > 1 ? argv[1] : "/tmp/exception_handling_accounts.sock";
+
+    struct sigaction action {};
+    action.sa_handler = requestStop;   // no SA_RESTART: epoll_wait returns EINTR and the loop checks the flag
+    ::sigaction(SIGINT, &action, nullptr);
+    ::sigaction(SIGTERM, &action, nullptr);
+    ::signal(SIGPIPE, SIG_IGN);        // a client that went away is a failed write, not a dead server
+
+    return Server(path).run();
+}
@@ -0,0 +1,71 @@
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "breadcrumbs.h"
+
+// Print a breadcrumb file written by write_breadcrumbs() or the breadcrumb terminate handler.
+// One line per operation, oldest first, with its age relative to the moment the snapshot was taken.
+//
+// Usage: BreadcrumbDecode <file>
+
+namespace {
+
+const char* opName(BreadcrumbOp op) {
+    switch (op) {
+        case BreadcrumbOp::Deposit: return "deposit";
+        case BreadcrumbOp::Withdraw: return "withdraw";
+        case BreadcrumbOp::TryDeposit: return "tryDeposit";
+        case BreadcrumbOp::TryWithdraw: return "tryWithdraw";
+    }
+    return "?";
+}
+
+const char* reasonName(BreadcrumbReason reason) {
+    switch (reason) {
+        case BreadcrumbReason::Manual: return "snapshot";
+        case BreadcrumbReason::Exception: return "exception";
+        case BreadcrumbReason::Terminate: return "std::terminate";
+    }
+    return "?";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: %s <breadcrumb file>\n", argv[0]);
+        return 2;
+    }
+    std::FILE* file = std::fopen(argv[1], "rb");
+    if (file == nullptr) {
+        std::perror(argv[1]);
+        return 1;
+    }
+    BreadcrumbFileHeader header{};
+    if (std::fread(&header, sizeof header, 1, file) != 1 ||
+        std::memcmp(header.magic, kBreadcrumbMagic, sizeof header.magic) != 0 ||
+        header.recordSize != sizeof(Breadcrumb) || header.count > kBreadcrumbCapacity) {
+        std::fprintf(stderr, "%s: not a breadcrumb file\n", argv[1]);
+        std::fclose(file);
+        return 1;
+    }
+    std::vector<Breadcrumb> crumbs(header.count);
+    const std::size_t read = std::fread(crumbs.data(), sizeof(Breadcrumb), crumbs.size(), file);
+    std::fclose(file);
+    if (read != crumbs.size()) {
+        std::fprintf(stderr, "%s: truncated, %zu of %llu records\n", argv[1], read,
+                     static_cast<unsigned long long>(header.count));
+        crumbs.resize(read);
+    }
+
+    std::printf("%zu breadcrumbs, taken at %s\n", crumbs.size(), reasonName(header.reason));
+    std::printf("%14s  %-12s %-18s %14s\n", "age us", "operation", "account", "amount");
+    for (const Breadcrumb& crumb : crumbs) {
+        const double ageUs = static_cast<double>(static_cast<std::int64_t>(header.taken - crumb.timestamp)) /
+                             header.ticksPerNanosecond / 1000.0;
+        std::printf("%14.3f  %-12s 0x%016llx %14.2f\n", -ageUs, opName(crumb.op),
+                    static_cast<unsigned long long>(crumb.account), crumb.amount);
+    }
+    return 0;
+}
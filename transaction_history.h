@@ -0,0 +1,330 @@
+#ifndef EXCEPTIONHANDLING_TRANSACTION_HISTORY_H
+#define EXCEPTIONHANDLING_TRANSACTION_HISTORY_H
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <ostream>
+#include <vector>
+
+// Append-only transaction history, for account statements.
+//
+// BankAccount keeps only its balance. TransactionHistory keeps every deposit and withdrawal of all accounts:
+//
+//     TransactionHistory history;
+//     if (account.tryDeposit(amount) == AccountStatus::Ok) history.append(id, now, HistoryOp::Deposit, amount);
+//     ...
+//     history.writeStatement(out, {.account = id, .from = monthStart, .to = monthEnd});
+//
+// The history is stored by column, in blocks of kBlockRows transactions. While a block fills, its columns are plain
+// arrays. A full block is sealed: each column is encoded on its own, into one byte buffer per block:
+//   account    account - (smallest account in the block), as a varint (7 bits per byte, high bit = more bytes)
+//   timestamp  difference to the previous row's timestamp, zigzag varint (usually 1 or 2 bytes: time only grows)
+//   op         2 bits per row
+//   amount     whole cents as a zigzag varint if every amount of the block is a whole number of cents,
+//              otherwise the 8-byte doubles
+// A row is about 7 bytes instead of 25. Each block also has the smallest and largest account and timestamp.
+//
+// A scan (a statement for an account, or everything in a time range) skips every block whose ranges cannot match,
+// without reading its data. Timestamps grow with the blocks, so a time range reads only the blocks of that time.
+// Accounts are mixed in every block unless the workload clusters them, so a statement for one account over a long
+// time reads the blocks in the range, but first only their account column: the other columns of a block are decoded
+// only when the account is in it.
+//
+// Timestamps are chosen by the caller (seconds, milliseconds, ...), and may go back a little; amounts are the amounts
+// of the operations, not signed. Not thread-safe; a scan must not run at the same time as an append().
+
+enum class HistoryOp : std::uint8_t {
+    Deposit = 1,
+    Withdraw = 2,
+};
+
+struct HistoryRow {
+    std::uint64_t account;
+    std::uint64_t timestamp;
+    HistoryOp op;
+    double amount;
+};
+
+// Rows of one account, or of all accounts, with from <= timestamp <= to.
+struct HistoryQuery {
+    static constexpr std::uint64_t kAllAccounts = std::numeric_limits<std::uint64_t>::max();
+
+    std::uint64_t account = kAllAccounts;
+    std::uint64_t from = 0;
+    std::uint64_t to = std::numeric_limits<std::uint64_t>::max();
+};
+
+// What a scan did: rows that matched, and sealed blocks read or skipped by their ranges.
+struct HistoryScanStats {
+    std::size_t rows = 0;
+    std::size_t blocksRead = 0;
+    std::size_t blocksSkipped = 0;
+};
+
+class TransactionHistory {
+public:
+    static constexpr std::size_t kBlockRows = 4096;
+
+    TransactionHistory() { reserveOpenBlock(); }
+
+    void append(std::uint64_t account, std::uint64_t timestamp, HistoryOp op, double amount) {
+        open_.accounts.push_back(account);
+        open_.timestamps.push_back(timestamp);
+        open_.ops.push_back(op);
+        open_.amounts.push_back(amount);
+        if (open_.accounts.size() == kBlockRows) {
+            seal();
+        }
+    }
+
+    // Call visit(const HistoryRow&) for every matching row, in append order.
+    template <typename Visit>
+    HistoryScanStats scan(const HistoryQuery& query, Visit&& visit) const {
+        HistoryScanStats stats;
+        Columns decoded;
+        for (const Block& block : blocks_) {
+            if (!block.mayMatch(query)) {
+                ++stats.blocksSkipped;
+                continue;
+            }
+            ++stats.blocksRead;
+            if (!decode(block, query, decoded)) {
+                continue;
+            }
+            stats.rows += visitRows(decoded, query, visit);
+        }
+        stats.rows += visitRows(open_, query, visit);
+        return stats;
+    }
+
+    // Statement as CSV lines "account,timestamp,op,amount", formatted without locale or iostream overhead
+    // into a buffer that is written out whenever it is nearly full.
+    HistoryScanStats writeStatement(std::ostream& out, const HistoryQuery& query) const {
+        std::vector<char> buffer(kStatementBuffer);
+        std::size_t used = 0;
+        const HistoryScanStats stats = scan(query, [&](const HistoryRow& row) {
+            if (used > buffer.size() - kMaxLine) {
+                out.write(buffer.data(), static_cast<std::streamsize>(used));
+                used = 0;
+            }
+            char* position = buffer.data() + used;
+            char* const end = buffer.data() + buffer.size();
+            position = std::to_chars(position, end, row.account).ptr;
+            *position++ = ',';
+            position = std::to_chars(position, end, row.timestamp).ptr;
+            const char* name = row.op == HistoryOp::Deposit ? ",deposit," : ",withdraw,";
+            const std::size_t nameLength = std::strlen(name);
+            std::memcpy(position, name, nameLength);
+            position += nameLength;
+            position = std::to_chars(position, end, row.amount).ptr;
+            *position++ = '\n';
+            used = static_cast<std::size_t>(position - buffer.data());
+        });
+        out.write(buffer.data(), static_cast<std::streamsize>(used));
+        return stats;
+    }
+
+    std::size_t size() const noexcept { return blocks_.size() * kBlockRows + open_.accounts.size(); }
+
+    // Memory of the encoded blocks (data and ranges) and of the block being filled.
+    std::size_t bytes() const noexcept {
+        std::size_t total = blocks_.size() * sizeof(Block) + open_.accounts.capacity() * kRawRowBytes;
+        for (const Block& block : blocks_) {
+            total += block.data.size();
+        }
+        return total;
+    }
+
+private:
+    static constexpr std::size_t kRawRowBytes = 2 * sizeof(std::uint64_t) + sizeof(HistoryOp) + sizeof(double);
+    static constexpr std::size_t kStatementBuffer = 1 << 16;
+    static constexpr std::size_t kMaxLine = 96;   // two 20-digit numbers, an op and the longest double
+    static constexpr std::size_t kMaxVarint = 10;   // bytes of a 64-bit varint
+
+    // The columns of the block being filled, and of a sealed block while it is scanned.
+    struct Columns {
+        std::vector<std::uint64_t> accounts;
+        std::vector<std::uint64_t> timestamps;
+        std::vector<HistoryOp> ops;
+        std::vector<double> amounts;
+    };
+
+    struct Block {
+        std::uint64_t minAccount;
+        std::uint64_t maxAccount;
+        std::uint64_t minTimestamp;
+        std::uint64_t maxTimestamp;
+        std::uint64_t firstTimestamp;
+        std::uint32_t timestampsAt;   // where each column starts in data (accounts start at 0)
+        std::uint32_t opsAt;
+        std::uint32_t amountsAt;
+        bool amountsInCents;
+        std::vector<std::uint8_t> data;
+
+        bool mayMatch(const HistoryQuery& query) const noexcept {
+            if (maxTimestamp < query.from || minTimestamp > query.to) {
+                return false;
+            }
+            return query.account == HistoryQuery::kAllAccounts ||
+                   (query.account >= minAccount && query.account <= maxAccount);
+        }
+    };
+
+    void reserveOpenBlock() {
+        open_.accounts.reserve(kBlockRows);
+        open_.timestamps.reserve(kBlockRows);
+        open_.ops.reserve(kBlockRows);
+        open_.amounts.reserve(kBlockRows);
+    }
+
+    void seal() {
+        Block block;
+        const auto [minAccount, maxAccount] = std::minmax_element(open_.accounts.begin(), open_.accounts.end());
+        const auto [minTimestamp, maxTimestamp] = std::minmax_element(open_.timestamps.begin(), open_.timestamps.end());
+        block.minAccount = *minAccount;
+        block.maxAccount = *maxAccount;
+        block.minTimestamp = *minTimestamp;
+        block.maxTimestamp = *maxTimestamp;
+        block.firstTimestamp = open_.timestamps.front();
+        block.amountsInCents = std::all_of(open_.amounts.begin(), open_.amounts.end(), [](double amount) {
+            return std::abs(amount) < kMaxCents / 100.0 && static_cast<double>(toCents(amount)) / 100.0 == amount;
+        });
+
+        // Encode into scratch space for the worst case, then copy what was used into a buffer of that size.
+        encoded_.resize(kBlockRows * (2 * kMaxVarint + sizeof(double)) + kBlockRows / 4);
+        std::uint8_t* const begin = encoded_.data();
+        std::uint8_t* out = begin;
+        for (std::uint64_t account : open_.accounts) {
+            putVarint(out, account - block.minAccount);
+        }
+        block.timestampsAt = static_cast<std::uint32_t>(out - begin);
+        std::uint64_t previous = block.firstTimestamp;
+        for (std::uint64_t timestamp : open_.timestamps) {
+            putVarint(out, zigzag(static_cast<std::int64_t>(timestamp - previous)));
+            previous = timestamp;
+        }
+        block.opsAt = static_cast<std::uint32_t>(out - begin);
+        for (std::size_t row = 0; row < kBlockRows; row += 4) {
+            *out++ = static_cast<std::uint8_t>(static_cast<unsigned>(open_.ops[row]) |
+                                               static_cast<unsigned>(open_.ops[row + 1]) << 2 |
+                                               static_cast<unsigned>(open_.ops[row + 2]) << 4 |
+                                               static_cast<unsigned>(open_.ops[row + 3]) << 6);
+        }
+        block.amountsAt = static_cast<std::uint32_t>(out - begin);
+        if (block.amountsInCents) {
+            for (double amount : open_.amounts) {
+                putVarint(out, zigzag(toCents(amount)));
+            }
+        } else {
+            std::memcpy(out, open_.amounts.data(), kBlockRows * sizeof(double));
+            out += kBlockRows * sizeof(double);
+        }
+        block.data.assign(begin, out);
+        blocks_.push_back(std::move(block));
+
+        open_.accounts.clear();
+        open_.timestamps.clear();
+        open_.ops.clear();
+        open_.amounts.clear();
+    }
+
+    // Decode the columns of a sealed block for a scan. For a one-account query the account column comes first,
+    // and the rest only if the account is in the block. Returns false when no row can match.
+    static bool decode(const Block& block, const HistoryQuery& query, Columns& columns) {
+        columns.accounts.resize(kBlockRows);
+        const std::uint8_t* in = block.data.data();
+        for (std::uint64_t& account : columns.accounts) {
+            account = block.minAccount + getVarint(in);
+        }
+        if (query.account != HistoryQuery::kAllAccounts &&
+            std::find(columns.accounts.begin(), columns.accounts.end(), query.account) == columns.accounts.end()) {
+            return false;
+        }
+
+        columns.timestamps.resize(kBlockRows);
+        in = block.data.data() + block.timestampsAt;
+        std::uint64_t timestamp = block.firstTimestamp;
+        for (std::uint64_t& value : columns.timestamps) {
+            timestamp += static_cast<std::uint64_t>(unzigzag(getVarint(in)));
+            value = timestamp;
+        }
+        columns.ops.resize(kBlockRows);
+        const std::uint8_t* ops = block.data.data() + block.opsAt;
+        for (std::size_t row = 0; row < kBlockRows; ++row) {
+            columns.ops[row] = static_cast<HistoryOp>((ops[row / 4] >> (row % 4 * 2)) & 3);
+        }
+        columns.amounts.resize(kBlockRows);
+        in = block.data.data() + block.amountsAt;
+        if (block.amountsInCents) {
+            for (double& amount : columns.amounts) {
+                amount = static_cast<double>(unzigzag(getVarint(in))) / 100.0;
+            }
+        } else {
+            std::memcpy(columns.amounts.data(), in, kBlockRows * sizeof(double));
+        }
+        return true;
+    }
+
+    template <typename Visit>
+    static std::size_t visitRows(const Columns& columns, const HistoryQuery& query, Visit& visit) {
+        std::size_t rows = 0;
+        for (std::size_t row = 0; row < columns.accounts.size(); ++row) {
+            const std::uint64_t timestamp = columns.timestamps[row];
+            if ((query.account != HistoryQuery::kAllAccounts && columns.accounts[row] != query.account) ||
+                timestamp < query.from || timestamp > query.to) {
+                continue;
+            }
+            const HistoryRow found{columns.accounts[row], timestamp, columns.ops[row], columns.amounts[row]};
+            visit(found);
+            ++rows;
+        }
+        return rows;
+    }
+
+    // Cents fit into a double exactly up to 2^53; beyond that an amount is stored as a double.
+    static constexpr double kMaxCents = 9007199254740992.0;
+
+    // Rounded to the nearest cent (without std::llround, which is a library call).
+    static std::int64_t toCents(double amount) noexcept {
+        const double cents = amount * 100.0;
+        return static_cast<std::int64_t>(cents + std::copysign(0.5, cents));
+    }
+
+    static std::uint64_t zigzag(std::int64_t value) noexcept {
+        return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+    }
+
+    static std::int64_t unzigzag(std::uint64_t value) noexcept {
+        return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+    }
+
+    static void putVarint(std::uint8_t*& out, std::uint64_t value) noexcept {
+        while (value >= 0x80) {
+            *out++ = static_cast<std::uint8_t>(value | 0x80);
+            value >>= 7;
+        }
+        *out++ = static_cast<std::uint8_t>(value);
+    }
+
+    static std::uint64_t getVarint(const std::uint8_t*& in) noexcept {
+        std::uint64_t value = 0;
+        for (unsigned shift = 0;; shift += 7) {
+            const std::uint8_t byte = *in++;
+            value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+            if (byte < 0x80) {
+                return value;
+            }
+        }
+    }
+
+    std::vector<Block> blocks_;
+    Columns open_;
+    std::vector<std::uint8_t> encoded_;   // scratch space of seal()
+};
+
+#endif //EXCEPTIONHANDLING_TRANSACTION_HISTORY_H
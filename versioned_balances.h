@@ -0,0 +1,401 @@
+#ifndef EXCEPTIONHANDLING_VERSIONED_BALANCES_H
+#define EXCEPTIONHANDLING_VERSIONED_BALANCES_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "error_codes.h"
+#include "throw_helpers.h"
+
+// Balances with point-in-time snapshots for long reports (multi-version concurrency control).
+//
+// A report that adds up getBalance() over millions of accounts while deposits and withdrawals go on sees some
+// accounts before and some after each operation: the total matches no moment in time. Locking everything for the
+// length of the report would stop the writers instead. VersionedBalances keeps old versions of a balance only
+// while a snapshot may still need them:
+//
+//     VersionedBalances balances(10'000'000, 100.0);
+//     // writer threads:  balances.deposit(account, amount);  balances.withdraw(account, amount);
+//     // report thread:
+//     const VersionedBalances::Snapshot snapshot = balances.snapshot();
+//     const double total = snapshot.total();           // as of the moment snapshot() returned
+//
+// Epochs. A global epoch counts the snapshots taken. Every write is tagged with the epoch it ran in, and a snapshot
+// pins the epoch that was current when it was taken and then moves the global epoch on: the snapshot sees every
+// write of its epoch or before, and none after. Writers hold a lock per stripe of accounts (as SharedAccountStore
+// does), and snapshot() takes each stripe lock once after moving the epoch on, so that the writes of the old epoch
+// that were in flight have finished; writers wait at most for one lock handover, never for a report.
+//
+// Versions. Each account has its newest balance and epoch in place, and a list of older versions behind it.
+// A write that would overwrite a balance some pinned snapshot can still see first copies it into a version
+// ("copy on write"). That happens on the first write to an account after a snapshot; further writes in the same
+// epoch, and every write while no snapshot is pinned, change the balance in place. A snapshot reader takes
+// the newest version of its epoch or older, without locks.
+//
+// Reclamation. A version is needed only by the pinned snapshots that fall between its epoch and the next newer
+// version's. Copy on write cuts each list below the first version the oldest pinned snapshot can see,
+// and releasing a snapshot goes through the accounts that have versions and does the same for the new oldest one
+// (all versions once no snapshot is left). No reader can be past the cut: every pinned snapshot stops at or before
+// that version. Freed versions go to a free list per stripe and are reused; a free list keeps at most
+// kMaxFreeVersions, the rest are deleted, so the memory of a large snapshot goes back once it is released.
+//
+// So the memory overhead of a snapshot is one version (24 bytes) for each account written since it was taken, and
+// the writer overhead is the stripe lock, plus one copy per account and snapshot.
+//
+// The account rules are BankAccount's (same exceptions and AccountStatus values).
+
+class VersionedBalances {
+public:
+    static constexpr std::size_t kStripes = 64;
+    // Freed versions kept per stripe for reuse (64 * 1024 * 24 bytes = 1.5 MB at most).
+    static constexpr std::size_t kMaxFreeVersions = 1024;
+
+    class Snapshot;
+
+    explicit VersionedBalances(std::size_t accounts, double initialBalance = 0.0)
+        : slots_(accounts), older_(accounts) {
+        for (Slot& slot : slots_) {
+            slot.balance.store(initialBalance, std::memory_order_relaxed);
+        }
+    }
+
+    VersionedBalances(const VersionedBalances&) = delete;
+    VersionedBalances& operator=(const VersionedBalances&) = delete;
+
+    // Snapshots must be released before the balances are destroyed.
+    ~VersionedBalances() {
+        for (std::atomic<Version*>& older : older_) {
+            freeList(older.load(std::memory_order_relaxed));
+        }
+        for (Stripe& stripe : stripes_) {
+            for (Version* version : stripe.free) {
+                delete version;
+            }
+        }
+    }
+
+    // NaN fails !(amount > 0.0) but passes amount <= 0.0, and a NaN balance would let every withdrawal through.
+    void deposit(std::size_t account, double amount) {
+        if (account >= slots_.size()) {
+            throw_unknown_account(account);
+        }
+        if (!(amount > 0.0)) {
+            throw_invalid_amount("Invalid deposit amount", amount);
+        }
+        Stripe& stripe = stripeOf(account);
+        const std::lock_guard<std::mutex> lock(stripe.mutex);
+        write(stripe, account, slots_[account].balance.load(std::memory_order_relaxed) + amount);
+    }
+
+    void withdraw(std::size_t account, double amount) {
+        if (account >= slots_.size()) {
+            throw_unknown_account(account);
+        }
+        if (!(amount > 0.0)) {
+            throw_invalid_amount("Invalid withdrawal amount", amount);
+        }
+        Stripe& stripe = stripeOf(account);
+        const std::lock_guard<std::mutex> lock(stripe.mutex);
+        const double balance = slots_[account].balance.load(std::memory_order_relaxed);
+        if (amount > balance) {
+            throw_insufficient_funds(amount, balance);
+        }
+        write(stripe, account, balance - amount);
+    }
+
+    AccountStatus tryDeposit(std::size_t account, double amount) {
+        if (account >= slots_.size()) {
+            return AccountStatus::UnknownAccount;
+        }
+        if (!(amount > 0.0)) {
+            return AccountStatus::InvalidAmount;
+        }
+        Stripe& stripe = stripeOf(account);
+        const std::lock_guard<std::mutex> lock(stripe.mutex);
+        write(stripe, account, slots_[account].balance.load(std::memory_order_relaxed) + amount);
+        return AccountStatus::Ok;
+    }
+
+    AccountStatus tryWithdraw(std::size_t account, double amount) {
+        if (account >= slots_.size()) {
+            return AccountStatus::UnknownAccount;
+        }
+        if (!(amount > 0.0)) {
+            return AccountStatus::InvalidAmount;
+        }
+        Stripe& stripe = stripeOf(account);
+        const std::lock_guard<std::mutex> lock(stripe.mutex);
+        const double balance = slots_[account].balance.load(std::memory_order_relaxed);
+        if (amount > balance) {
+            return AccountStatus::InsufficientFunds;
+        }
+        write(stripe, account, balance - amount);
+        return AccountStatus::Ok;
+    }
+
+    // The newest balance, as a single read: it may be older than a write another thread is just making.
+    double getBalance(std::size_t account) const {
+        if (account >= slots_.size()) {
+            throw_unknown_account(account);
+        }
+        return slots_[account].balance.load(std::memory_order_acquire);
+    }
+
+    // Pin the current state. Cheap: it moves the epoch on and takes each stripe lock once;
+    // nothing is copied until writers change balances.
+    Snapshot snapshot();
+
+    std::size_t size() const noexcept { return slots_.size(); }
+
+    // Old versions kept for pinned snapshots, and their memory (not counting the free lists).
+    std::size_t versions() const {
+        std::size_t count = 0;
+        for (const Stripe& stripe : stripes_) {
+            const std::lock_guard<std::mutex> lock(stripe.mutex);
+            count += stripe.versions;
+        }
+        return count;
+    }
+
+    std::size_t versionBytes() const { return versions() * sizeof(Version); }
+
+    // Freed versions waiting on the free lists for reuse, at most kStripes * kMaxFreeVersions.
+    std::size_t freeVersions() const {
+        std::size_t count = 0;
+        for (const Stripe& stripe : stripes_) {
+            const std::lock_guard<std::mutex> lock(stripe.mutex);
+            count += stripe.free.size();
+        }
+        return count;
+    }
+
+private:
+    static constexpr std::uint64_t kNoSnapshot = std::numeric_limits<std::uint64_t>::max();
+
+    // An older balance of an account. balance and epoch do not change once the version is published,
+    // older is cut (set to nullptr) by reclamation.
+    struct Version {
+        double balance;
+        std::uint64_t epoch;
+        std::atomic<Version*> older;
+    };
+
+    static_assert(sizeof(Version) == 24, "versionBytes() reports 24 bytes per version");
+
+    // The newest balance of an account and the epoch of the write that made it. Written only under the stripe lock,
+    // read by snapshots without it. 16 bytes, so a slot never spans two cache lines; the list of older versions
+    // is in a separate array (older_), which writes and snapshots only look at once a snapshot needs it.
+    struct alignas(16) Slot {
+        std::atomic<double> balance{0.0};
+        std::atomic<std::uint64_t> epoch{0};
+    };
+
+    struct alignas(64) Stripe {
+        mutable std::mutex mutex;
+        std::vector<std::size_t> versioned;   // accounts of this stripe with older versions
+        std::vector<Version*> free;
+        std::size_t versions = 0;
+    };
+
+    Stripe& stripeOf(std::size_t account) noexcept { return stripes_[account % kStripes]; }
+
+    // Set a new balance, with the stripe lock held.
+    void write(Stripe& stripe, std::size_t account, double balance) {
+        Slot& slot = slots_[account];
+        // The epoch may move on while we hold the lock; snapshot() waits for the lock, so this write counts
+        // in the epoch read here.
+        const std::uint64_t epoch = epoch_.load(std::memory_order_acquire);
+        const std::uint64_t oldest = oldestPinned_.load(std::memory_order_acquire);
+        const std::uint64_t current = slot.epoch.load(std::memory_order_relaxed);
+        if (current == epoch || oldest == kNoSnapshot) {
+            // No pinned snapshot can see the balance being replaced.
+            slot.balance.store(balance, std::memory_order_release);
+            return;
+        }
+        Version* version = allocate(stripe);
+        version->balance = slot.balance.load(std::memory_order_relaxed);
+        version->epoch = current;
+        Version* older = older_[account].load(std::memory_order_relaxed);
+        version->older.store(older, std::memory_order_relaxed);
+        if (older == nullptr) {
+            stripe.versioned.push_back(account);
+        }
+        ++stripe.versions;
+        // Readers check the epoch before and after reading the balance: the new epoch goes out before the new
+        // balance, and the version with the old balance before both.
+        older_[account].store(version, std::memory_order_release);
+        slot.epoch.store(epoch, std::memory_order_release);
+        slot.balance.store(balance, std::memory_order_release);
+        trim(stripe, account, oldest);
+    }
+
+    // Free the versions behind the first one (the slot included) that the oldest pinned snapshot sees:
+    // no pinned snapshot reads past it.
+    void trim(Stripe& stripe, std::size_t account, std::uint64_t oldest) noexcept {
+        std::atomic<Version*>* cut = &older_[account];
+        if (slots_[account].epoch.load(std::memory_order_relaxed) > oldest) {
+            Version* version = older_[account].load(std::memory_order_relaxed);
+            while (version != nullptr && version->epoch > oldest) {
+                version = version->older.load(std::memory_order_relaxed);
+            }
+            if (version == nullptr) {
+                return;
+            }
+            cut = &version->older;
+        }
+        Version* rest = cut->load(std::memory_order_relaxed);
+        if (rest == nullptr) {
+            return;
+        }
+        cut->store(nullptr, std::memory_order_release);
+        while (rest != nullptr) {
+            Version* next = rest->older.load(std::memory_order_relaxed);
+            if (stripe.free.size() < kMaxFreeVersions) {
+                stripe.free.push_back(rest);
+            } else {
+                delete rest;
+            }
+            --stripe.versions;
+            rest = next;
+        }
+    }
+
+    // After a snapshot was released: trim every account with versions for the new oldest snapshot.
+    void reclaim(std::uint64_t oldest) {
+        for (Stripe& stripe : stripes_) {
+            const std::lock_guard<std::mutex> lock(stripe.mutex);
+            for (std::size_t i = 0; i < stripe.versioned.size();) {
+                const std::size_t account = stripe.versioned[i];
+                trim(stripe, account, oldest);
+                if (older_[account].load(std::memory_order_relaxed) == nullptr) {
+                    stripe.versioned[i] = stripe.versioned.back();
+                    stripe.versioned.pop_back();
+                } else {
+                    ++i;
+                }
+            }
+        }
+    }
+
+    Version* allocate(Stripe& stripe) {
+        if (stripe.free.empty()) {
+            return new Version{};
+        }
+        Version* version = stripe.free.back();
+        stripe.free.pop_back();
+        return version;
+    }
+
+    static void freeList(Version* version) noexcept {
+        while (version != nullptr) {
+            Version* next = version->older.load(std::memory_order_relaxed);
+            delete version;
+            version = next;
+        }
+    }
+
+    // Balance of an account as of epoch, without locks.
+    double balanceAt(std::size_t account, std::uint64_t epoch) const noexcept {
+        const Slot& slot = slots_[account];
+        const std::uint64_t before = slot.epoch.load(std::memory_order_acquire);
+        if (before <= epoch) {
+            const double balance = slot.balance.load(std::memory_order_acquire);
+            // An unchanged epoch means no write replaced the balance in between: a write after the snapshot
+            // always comes with a newer epoch.
+            if (slot.epoch.load(std::memory_order_acquire) == before) {
+                return balance;
+            }
+        }
+        // The snapshot's balance was copied into a version before the slot changed.
+        const Version* version = older_[account].load(std::memory_order_acquire);
+        while (version->epoch > epoch) {
+            version = version->older.load(std::memory_order_acquire);
+        }
+        return version->balance;
+    }
+
+    void release(std::uint64_t epoch) {
+        const std::lock_guard<std::mutex> lock(snapshotMutex_);
+        pinned_.erase(std::find(pinned_.begin(), pinned_.end(), epoch));
+        const std::uint64_t oldest = pinned_.empty() ? kNoSnapshot : *std::min_element(pinned_.begin(), pinned_.end());
+        oldestPinned_.store(oldest, std::memory_order_release);
+        // Under snapshotMutex_, so that a snapshot pinned meanwhile does not lose versions to a stale oldest.
+        reclaim(oldest);
+    }
+
+    std::vector<Slot> slots_;
+    std::vector<std::atomic<Version*>> older_;            // per account, its newest older version
+    Stripe stripes_[kStripes];
+    std::atomic<std::uint64_t> epoch_{1};                  // epoch of new writes; the initial balances are epoch 0
+    std::atomic<std::uint64_t> oldestPinned_{kNoSnapshot};
+    std::mutex snapshotMutex_;
+    std::vector<std::uint64_t> pinned_;                    // epochs of the pinned snapshots
+};
+
+// A pinned point in time. Readable from any thread while writers go on; release it (destroy it) soon after the
+// report, every write to an account since it was taken keeps a version alive until then.
+class VersionedBalances::Snapshot {
+public:
+    Snapshot(Snapshot&& other) noexcept
+        : balances_(std::exchange(other.balances_, nullptr)), epoch_(other.epoch_) {}
+    Snapshot& operator=(Snapshot&&) = delete;
+
+    ~Snapshot() {
+        if (balances_ != nullptr) {
+            balances_->release(epoch_);
+        }
+    }
+
+    double getBalance(std::size_t account) const {
+        if (account >= balances_->size()) {
+            throw_unknown_account(account);
+        }
+        return balances_->balanceAt(account, epoch_);
+    }
+
+    // Sum of all balances at the snapshot.
+    double total() const noexcept {
+        double sum = 0.0;
+        for (std::size_t account = 0; account < balances_->size(); ++account) {
+            sum += balances_->balanceAt(account, epoch_);
+        }
+        return sum;
+    }
+
+    std::uint64_t epoch() const noexcept { return epoch_; }
+
+private:
+    friend class VersionedBalances;
+
+    Snapshot(VersionedBalances& balances, std::uint64_t epoch) noexcept : balances_(&balances), epoch_(epoch) {}
+
+    VersionedBalances* balances_;
+    std::uint64_t epoch_;
+};
+
+inline VersionedBalances::Snapshot VersionedBalances::snapshot() {
+    std::uint64_t epoch;
+    {
+        const std::lock_guard<std::mutex> lock(snapshotMutex_);
+        epoch = epoch_.load(std::memory_order_relaxed);
+        pinned_.push_back(epoch);
+        oldestPinned_.store(std::min(oldestPinned_.load(std::memory_order_relaxed), epoch),
+                            std::memory_order_release);
+        // Writers that read the new epoch also see the snapshot pinned.
+        epoch_.store(epoch + 1, std::memory_order_release);
+    }
+    // Wait for the writes of the old epoch: each of them holds its stripe lock from reading the epoch to storing
+    // the balance.
+    for (Stripe& stripe : stripes_) {
+        const std::lock_guard<std::mutex> lock(stripe.mutex);
+    }
+    return Snapshot(*this, epoch);
+}
+
+#endif //EXCEPTIONHANDLING_VERSIONED_BALANCES_H